@@ -5,8 +5,52 @@
 
 using namespace Rcpp;
 
+// barPrefetchInterface
+SEXP barPrefetchInterface(SEXP pathsIn, int capacity, int threads);
+RcppExport SEXP btutils_barPrefetchInterface(SEXP pathsInSEXP, SEXP capacitySEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type pathsIn(pathsInSEXP);
+    Rcpp::traits::input_parameter< int >::type capacity(capacitySEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(barPrefetchInterface(pathsIn, capacity, threads));
+    return __result;
+END_RCPP
+}
+// barPrefetchNextInterface
+SEXP barPrefetchNextInterface(SEXP prefetcherIn);
+RcppExport SEXP btutils_barPrefetchNextInterface(SEXP prefetcherInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type prefetcherIn(prefetcherInSEXP);
+    __result = Rcpp::wrap(barPrefetchNextInterface(prefetcherIn));
+    return __result;
+END_RCPP
+}
+// backtestSymbolsInterface
+Rcpp::List backtestSymbolsInterface(SEXP symbolsIn, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize, bool inDollars, bool summary, double periods, int threads);
+RcppExport SEXP btutils_backtestSymbolsInterface(SEXP symbolsInSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP, SEXP inDollarsSEXP, SEXP summarySEXP, SEXP periodsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type symbolsIn(symbolsInSEXP);
+    Rcpp::traits::input_parameter< double >::type stopLoss(stopLossSEXP);
+    Rcpp::traits::input_parameter< double >::type stopTrailing(stopTrailingSEXP);
+    Rcpp::traits::input_parameter< double >::type profitTarget(profitTargetSEXP);
+    Rcpp::traits::input_parameter< int >::type maxDays(maxDaysSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type inDollars(inDollarsSEXP);
+    Rcpp::traits::input_parameter< bool >::type summary(summarySEXP);
+    Rcpp::traits::input_parameter< double >::type periods(periodsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(backtestSymbolsInterface(symbolsIn, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, inDollars, summary, periods, threads));
+    return __result;
+END_RCPP
+}
 // capTradeDurationInterface
-Rcpp::NumericVector capTradeDurationInterface(SEXP indicatorIn, int shortMinCap, int longMinCap, int shortMaxCap, int longMaxCap, bool waitNewSignal);
+SEXP capTradeDurationInterface(SEXP indicatorIn, int shortMinCap, int longMinCap, int shortMaxCap, int longMaxCap, bool waitNewSignal);
 RcppExport SEXP btutils_capTradeDurationInterface(SEXP indicatorInSEXP, SEXP shortMinCapSEXP, SEXP longMinCapSEXP, SEXP shortMaxCapSEXP, SEXP longMaxCapSEXP, SEXP waitNewSignalSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
@@ -21,9 +65,26 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// capTradeDurationGridInterface
+Rcpp::List capTradeDurationGridInterface(SEXP indicatorIn, SEXP shortMinCapsIn, SEXP longMinCapsIn, SEXP shortMaxCapsIn, SEXP longMaxCapsIn, bool waitNewSignal, int threads);
+RcppExport SEXP btutils_capTradeDurationGridInterface(SEXP indicatorInSEXP, SEXP shortMinCapsInSEXP, SEXP longMinCapsInSEXP, SEXP shortMaxCapsInSEXP, SEXP longMaxCapsInSEXP, SEXP waitNewSignalSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type indicatorIn(indicatorInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type shortMinCapsIn(shortMinCapsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type longMinCapsIn(longMinCapsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type shortMaxCapsIn(shortMaxCapsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type longMaxCapsIn(longMaxCapsInSEXP);
+    Rcpp::traits::input_parameter< bool >::type waitNewSignal(waitNewSignalSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(capTradeDurationGridInterface(indicatorIn, shortMinCapsIn, longMinCapsIn, shortMaxCapsIn, longMaxCapsIn, waitNewSignal, threads));
+    return __result;
+END_RCPP
+}
 // constructIndicatorInterface
-Rcpp::NumericVector constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn);
-RcppExport SEXP btutils_constructIndicatorInterface(SEXP longEntriesInSEXP, SEXP longExitsInSEXP, SEXP shortEntriesInSEXP, SEXP shortExitsInSEXP) {
+SEXP constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn, bool runs);
+RcppExport SEXP btutils_constructIndicatorInterface(SEXP longEntriesInSEXP, SEXP longExitsInSEXP, SEXP shortEntriesInSEXP, SEXP shortExitsInSEXP, SEXP runsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
     Rcpp::RNGScope __rngScope;
@@ -31,7 +92,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type longExitsIn(longExitsInSEXP);
     Rcpp::traits::input_parameter< SEXP >::type shortEntriesIn(shortEntriesInSEXP);
     Rcpp::traits::input_parameter< SEXP >::type shortExitsIn(shortExitsInSEXP);
-    __result = Rcpp::wrap(constructIndicatorInterface(longEntriesIn, longExitsIn, shortEntriesIn, shortExitsIn));
+    Rcpp::traits::input_parameter< bool >::type runs(runsSEXP);
+    __result = Rcpp::wrap(constructIndicatorInterface(longEntriesIn, longExitsIn, shortEntriesIn, shortExitsIn, runs));
     return __result;
 END_RCPP
 }
@@ -47,6 +109,20 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// indicatorFromTrendlineBatchInterface
+Rcpp::NumericMatrix indicatorFromTrendlineBatchInterface(SEXP trendlineIn, SEXP thresholdsIn, SEXP multipliersIn, int threads);
+RcppExport SEXP btutils_indicatorFromTrendlineBatchInterface(SEXP trendlineInSEXP, SEXP thresholdsInSEXP, SEXP multipliersInSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type trendlineIn(trendlineInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type thresholdsIn(thresholdsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type multipliersIn(multipliersInSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(indicatorFromTrendlineBatchInterface(trendlineIn, thresholdsIn, multipliersIn, threads));
+    return __result;
+END_RCPP
+}
 // zigZagInterface
 Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent);
 RcppExport SEXP btutils_zigZagInterface(SEXP pricesInSEXP, SEXP changesInSEXP, SEXP percentSEXP) {
@@ -60,6 +136,94 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// zigZagMultiInterface
+Rcpp::List zigZagMultiInterface(SEXP pricesIn, SEXP changesIn, bool percent);
+RcppExport SEXP btutils_zigZagMultiInterface(SEXP pricesInSEXP, SEXP changesInSEXP, SEXP percentSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type changesIn(changesInSEXP);
+    Rcpp::traits::input_parameter< bool >::type percent(percentSEXP);
+    __result = Rcpp::wrap(zigZagMultiInterface(pricesIn, changesIn, percent));
+    return __result;
+END_RCPP
+}
+// zigZagStateInterface
+SEXP zigZagStateInterface(bool percent);
+RcppExport SEXP btutils_zigZagStateInterface(SEXP percentSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< bool >::type percent(percentSEXP);
+    __result = Rcpp::wrap(zigZagStateInterface(percent));
+    return __result;
+END_RCPP
+}
+// zigZagUpdateInterface
+Rcpp::List zigZagUpdateInterface(SEXP stateIn, SEXP pricesIn, SEXP changesIn);
+RcppExport SEXP btutils_zigZagUpdateInterface(SEXP stateInSEXP, SEXP pricesInSEXP, SEXP changesInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type stateIn(stateInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type changesIn(changesInSEXP);
+    __result = Rcpp::wrap(zigZagUpdateInterface(stateIn, pricesIn, changesIn));
+    return __result;
+END_RCPP
+}
+// returnsRsiInterface
+Rcpp::NumericVector returnsRsiInterface(SEXP returnsIn, int n);
+RcppExport SEXP btutils_returnsRsiInterface(SEXP returnsInSEXP, SEXP nSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type returnsIn(returnsInSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    __result = Rcpp::wrap(returnsRsiInterface(returnsIn, n));
+    return __result;
+END_RCPP
+}
+// returnsRsiBatchInterface
+Rcpp::NumericMatrix returnsRsiBatchInterface(SEXP returnsIn, SEXP nsIn, int threads);
+RcppExport SEXP btutils_returnsRsiBatchInterface(SEXP returnsInSEXP, SEXP nsInSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type returnsIn(returnsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type nsIn(nsInSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(returnsRsiBatchInterface(returnsIn, nsIn, threads));
+    return __result;
+END_RCPP
+}
+// splitBarsInterface
+Rcpp::List splitBarsInterface(SEXP lengthsIn, SEXP timesIn, SEXP columnsIn);
+RcppExport SEXP btutils_splitBarsInterface(SEXP lengthsInSEXP, SEXP timesInSEXP, SEXP columnsInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type lengthsIn(lengthsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type timesIn(timesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type columnsIn(columnsInSEXP);
+    __result = Rcpp::wrap(splitBarsInterface(lengthsIn, timesIn, columnsIn));
+    return __result;
+END_RCPP
+}
+// performanceStatsInterface
+Rcpp::List performanceStatsInterface(SEXP returnsIn, SEXP tradesIn, double periods);
+RcppExport SEXP btutils_performanceStatsInterface(SEXP returnsInSEXP, SEXP tradesInSEXP, SEXP periodsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type returnsIn(returnsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type tradesIn(tradesInSEXP);
+    Rcpp::traits::input_parameter< double >::type periods(periodsSEXP);
+    __result = Rcpp::wrap(performanceStatsInterface(returnsIn, tradesIn, periods));
+    return __result;
+END_RCPP
+}
 // processTradeInterface
 Rcpp::List processTradeInterface(SEXP opIn, SEXP hiIn, SEXP loIn, SEXP clIn, int ibeg, int iend, int pos, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize);
 RcppExport SEXP btutils_processTradeInterface(SEXP opInSEXP, SEXP hiInSEXP, SEXP loInSEXP, SEXP clInSEXP, SEXP ibegSEXP, SEXP iendSEXP, SEXP posSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP) {
@@ -128,6 +292,221 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// tradeIndicatorInterface
+Rcpp::List tradeIndicatorInterface(SEXP ohlcIn, SEXP indicatorIn, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize, bool inDollars);
+RcppExport SEXP btutils_tradeIndicatorInterface(SEXP ohlcInSEXP, SEXP indicatorInSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP, SEXP inDollarsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type indicatorIn(indicatorInSEXP);
+    Rcpp::traits::input_parameter< double >::type stopLoss(stopLossSEXP);
+    Rcpp::traits::input_parameter< double >::type stopTrailing(stopTrailingSEXP);
+    Rcpp::traits::input_parameter< double >::type profitTarget(profitTargetSEXP);
+    Rcpp::traits::input_parameter< int >::type maxDays(maxDaysSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type inDollars(inDollarsSEXP);
+    __result = Rcpp::wrap(tradeIndicatorInterface(ohlcIn, indicatorIn, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, inDollars));
+    return __result;
+END_RCPP
+}
+// indicatorRunsInterface
+Rcpp::List indicatorRunsInterface(SEXP indicatorIn);
+RcppExport SEXP btutils_indicatorRunsInterface(SEXP indicatorInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type indicatorIn(indicatorInSEXP);
+    __result = Rcpp::wrap(indicatorRunsInterface(indicatorIn));
+    return __result;
+END_RCPP
+}
+// indicatorDenseInterface
+Rcpp::NumericVector indicatorDenseInterface(SEXP runsIn);
+RcppExport SEXP btutils_indicatorDenseInterface(SEXP runsInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type runsIn(runsInSEXP);
+    __result = Rcpp::wrap(indicatorDenseInterface(runsIn));
+    return __result;
+END_RCPP
+}
+// barSessionInterface
+SEXP barSessionInterface(SEXP ohlcIn, SEXP timesIn);
+RcppExport SEXP btutils_barSessionInterface(SEXP ohlcInSEXP, SEXP timesInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type timesIn(timesInSEXP);
+    __result = Rcpp::wrap(barSessionInterface(ohlcIn, timesIn));
+    return __result;
+END_RCPP
+}
+// barSessionWhichInterface
+Rcpp::IntegerVector barSessionWhichInterface(SEXP sessionIn, SEXP timesIn);
+RcppExport SEXP btutils_barSessionWhichInterface(SEXP sessionInSEXP, SEXP timesInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type sessionIn(sessionInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type timesIn(timesInSEXP);
+    __result = Rcpp::wrap(barSessionWhichInterface(sessionIn, timesIn));
+    return __result;
+END_RCPP
+}
+// barSessionSizeInterface
+int barSessionSizeInterface(SEXP sessionIn);
+RcppExport SEXP btutils_barSessionSizeInterface(SEXP sessionInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type sessionIn(sessionInSEXP);
+    __result = Rcpp::wrap(barSessionSizeInterface(sessionIn));
+    return __result;
+END_RCPP
+}
+// barStoreWriteInterface
+void barStoreWriteInterface(std::string path, SEXP ohlcIn, SEXP timesIn, bool dateIndex);
+RcppExport SEXP btutils_barStoreWriteInterface(SEXP pathSEXP, SEXP ohlcInSEXP, SEXP timesInSEXP, SEXP dateIndexSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type timesIn(timesInSEXP);
+    Rcpp::traits::input_parameter< bool >::type dateIndex(dateIndexSEXP);
+    barStoreWriteInterface(path, ohlcIn, timesIn, dateIndex);
+    return R_NilValue;
+END_RCPP
+}
+// barStoreSessionInterface
+Rcpp::List barStoreSessionInterface(std::string path);
+RcppExport SEXP btutils_barStoreSessionInterface(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    __result = Rcpp::wrap(barStoreSessionInterface(path));
+    return __result;
+END_RCPP
+}
+// barStoreReadInterface
+Rcpp::List barStoreReadInterface(std::string path);
+RcppExport SEXP btutils_barStoreReadInterface(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    __result = Rcpp::wrap(barStoreReadInterface(path));
+    return __result;
+END_RCPP
+}
+// packSignalsInterface
+Rcpp::RawVector packSignalsInterface(SEXP signalsIn);
+RcppExport SEXP btutils_packSignalsInterface(SEXP signalsInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type signalsIn(signalsInSEXP);
+    __result = Rcpp::wrap(packSignalsInterface(signalsIn));
+    return __result;
+END_RCPP
+}
+// unpackSignalsInterface
+Rcpp::LogicalVector unpackSignalsInterface(SEXP signalsIn);
+RcppExport SEXP btutils_unpackSignalsInterface(SEXP signalsInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type signalsIn(signalsInSEXP);
+    __result = Rcpp::wrap(unpackSignalsInterface(signalsIn));
+    return __result;
+END_RCPP
+}
+// crossSignalsInterface
+Rcpp::RawVector crossSignalsInterface(SEXP xIn, SEXP yIn, int direction);
+RcppExport SEXP btutils_crossSignalsInterface(SEXP xInSEXP, SEXP yInSEXP, SEXP directionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type xIn(xInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type yIn(yInSEXP);
+    Rcpp::traits::input_parameter< int >::type direction(directionSEXP);
+    __result = Rcpp::wrap(crossSignalsInterface(xIn, yIn, direction));
+    return __result;
+END_RCPP
+}
+// laguerreRsiSignalsInterface
+Rcpp::RawVector laguerreRsiSignalsInterface(SEXP pricesIn, double gamma, double threshold, int direction);
+RcppExport SEXP btutils_laguerreRsiSignalsInterface(SEXP pricesInSEXP, SEXP gammaSEXP, SEXP thresholdSEXP, SEXP directionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
+    Rcpp::traits::input_parameter< double >::type threshold(thresholdSEXP);
+    Rcpp::traits::input_parameter< int >::type direction(directionSEXP);
+    __result = Rcpp::wrap(laguerreRsiSignalsInterface(pricesIn, gamma, threshold, direction));
+    return __result;
+END_RCPP
+}
+// zigZagSignalsInterface
+Rcpp::RawVector zigZagSignalsInterface(SEXP pricesIn, SEXP changesIn, bool percent, int direction);
+RcppExport SEXP btutils_zigZagSignalsInterface(SEXP pricesInSEXP, SEXP changesInSEXP, SEXP percentSEXP, SEXP directionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type changesIn(changesInSEXP);
+    Rcpp::traits::input_parameter< bool >::type percent(percentSEXP);
+    Rcpp::traits::input_parameter< int >::type direction(directionSEXP);
+    __result = Rcpp::wrap(zigZagSignalsInterface(pricesIn, changesIn, percent, direction));
+    return __result;
+END_RCPP
+}
+// sweepTradesInterface
+Rcpp::List sweepTradesInterface(SEXP ohlcIn, SEXP ibegsIn, SEXP iendsIn, SEXP positionIn, SEXP stopLossIn, SEXP stopTrailingIn, SEXP profitTargetIn, SEXP maxDaysIn, double tickSize, int threads);
+RcppExport SEXP btutils_sweepTradesInterface(SEXP ohlcInSEXP, SEXP ibegsInSEXP, SEXP iendsInSEXP, SEXP positionInSEXP, SEXP stopLossInSEXP, SEXP stopTrailingInSEXP, SEXP profitTargetInSEXP, SEXP maxDaysInSEXP, SEXP tickSizeSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type ibegsIn(ibegsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type iendsIn(iendsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type positionIn(positionInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stopLossIn(stopLossInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stopTrailingIn(stopTrailingInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type profitTargetIn(profitTargetInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type maxDaysIn(maxDaysInSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(sweepTradesInterface(ohlcIn, ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn, tickSize, threads));
+    return __result;
+END_RCPP
+}
+// sweepSummaryInterface
+Rcpp::List sweepSummaryInterface(SEXP ohlcIn, SEXP ibegsIn, SEXP iendsIn, SEXP positionIn, SEXP stopLossIn, SEXP stopTrailingIn, SEXP profitTargetIn, SEXP maxDaysIn, double tickSize, int threads, int top, std::string objective);
+RcppExport SEXP btutils_sweepSummaryInterface(SEXP ohlcInSEXP, SEXP ibegsInSEXP, SEXP iendsInSEXP, SEXP positionInSEXP, SEXP stopLossInSEXP, SEXP stopTrailingInSEXP, SEXP profitTargetInSEXP, SEXP maxDaysInSEXP, SEXP tickSizeSEXP, SEXP threadsSEXP, SEXP topSEXP, SEXP objectiveSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type ibegsIn(ibegsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type iendsIn(iendsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type positionIn(positionInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stopLossIn(stopLossInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stopTrailingIn(stopTrailingInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type profitTargetIn(profitTargetInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type maxDaysIn(maxDaysInSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type top(topSEXP);
+    Rcpp::traits::input_parameter< std::string >::type objective(objectiveSEXP);
+    __result = Rcpp::wrap(sweepSummaryInterface(ohlcIn, ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn, tickSize, threads, top, objective));
+    return __result;
+END_RCPP
+}
 // locfInterface
 Rcpp::NumericVector locfInterface(SEXP vin, double value);
 RcppExport SEXP btutils_locfInterface(SEXP vinSEXP, SEXP valueSEXP) {
@@ -140,6 +519,19 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// locfMatrixInterface
+Rcpp::NumericMatrix locfMatrixInterface(SEXP vin, double value, int threads);
+RcppExport SEXP btutils_locfMatrixInterface(SEXP vinSEXP, SEXP valueSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
+    Rcpp::traits::input_parameter< double >::type value(valueSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(locfMatrixInterface(vin, value, threads));
+    return __result;
+END_RCPP
+}
 // leadingNAs
 double leadingNAs(SEXP vin);
 RcppExport SEXP btutils_leadingNAs(SEXP vinSEXP) {
@@ -175,3 +567,39 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// laguerreBatchInterface
+Rcpp::NumericMatrix laguerreBatchInterface(SEXP vin, SEXP gammasIn, bool rsi);
+RcppExport SEXP btutils_laguerreBatchInterface(SEXP vinSEXP, SEXP gammasInSEXP, SEXP rsiSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type gammasIn(gammasInSEXP);
+    Rcpp::traits::input_parameter< bool >::type rsi(rsiSEXP);
+    __result = Rcpp::wrap(laguerreBatchInterface(vin, gammasIn, rsi));
+    return __result;
+END_RCPP
+}
+// laguerreStateInterface
+SEXP laguerreStateInterface(double gamma);
+RcppExport SEXP btutils_laguerreStateInterface(SEXP gammaSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
+    __result = Rcpp::wrap(laguerreStateInterface(gamma));
+    return __result;
+END_RCPP
+}
+// laguerreUpdateInterface
+Rcpp::NumericMatrix laguerreUpdateInterface(SEXP stateIn, SEXP pricesIn);
+RcppExport SEXP btutils_laguerreUpdateInterface(SEXP stateInSEXP, SEXP pricesInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type stateIn(stateInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    __result = Rcpp::wrap(laguerreUpdateInterface(stateIn, pricesIn));
+    return __result;
+END_RCPP
+}
@@ -0,0 +1,127 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+#include <chrono>
+
+#include "common.h"
+#include "session.h"
+#include "parallel.h"
+#include "barPrefetcher.h"
+
+BarPrefetcher::BarPrefetcher(const std::vector<std::string> & paths, int capacity, int threads)
+   : paths_(paths), capacity_(std::max(capacity, 1)), nextTask_(0), nextOut_(0), stop_(false)
+{
+   threads = threadCount(threads, paths_.size());
+   for(int tt = 0; tt < threads; ++tt) threads_.push_back(std::thread(&BarPrefetcher::work, this));
+}
+
+BarPrefetcher::~BarPrefetcher()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+   }
+   space_.notify_all();
+   for(std::size_t tt = 0; tt < threads_.size(); ++tt) threads_[tt].join();
+}
+
+void BarPrefetcher::work()
+{
+   for(;;) {
+      std::size_t task;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         space_.wait(lock, [this]() {
+            return stop_ || nextTask_ == paths_.size() || nextTask_ < nextOut_ + capacity_;
+         });
+         if(stop_ || nextTask_ == paths_.size()) return;
+         task = nextTask_++;
+      }
+
+      Slot slot;
+      slot.store.reset(new BarStore());
+      if(slot.store->open(paths_[task], slot.error)) {
+         // Read the pages in, the consumer shouldn't wait on the disk either
+         volatile double sink = 0.0;
+         int rows = slot.store->rows();
+         for(int cc = BarStore::TIMES; cc < BarStore::COLUMNS; ++cc) {
+            const double * column = slot.store->column(static_cast<BarStore::Column>(cc));
+            for(int ii = 0; ii < rows; ii += 512) sink = sink + column[ii];
+         }
+      } else {
+         slot.store.reset();
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         slots_[task] = std::move(slot);
+      }
+      ready_.notify_all();
+   }
+}
+
+bool BarPrefetcher::next(int milliseconds, std::unique_ptr<BarStore> & store, std::string & error)
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   std::map<std::size_t, Slot>::iterator it;
+   bool ready = ready_.wait_for(lock, std::chrono::milliseconds(milliseconds), [this, &it]() {
+      it = slots_.find(nextOut_);
+      return it != slots_.end();
+   });
+   if(!ready) return false;
+
+   store = std::move(it->second.store);
+   error = it->second.error;
+   slots_.erase(it);
+   ++nextOut_;
+
+   lock.unlock();
+   space_.notify_all();
+   return true;
+}
+
+// [[Rcpp::export("bar.prefetch.interface")]]
+SEXP barPrefetchInterface(SEXP pathsIn, int capacity, int threads)
+{
+   std::vector<std::string> paths = Rcpp::as< std::vector<std::string> >(pathsIn);
+   return wrapPointer(new BarPrefetcher(paths, capacity, threads), "bar prefetcher");
+}
+
+// The session of the next store (see bar.store.session.interface), NULL after the last
+// [[Rcpp::export("bar.prefetch.next.interface")]]
+SEXP barPrefetchNextInterface(SEXP prefetcherIn)
+{
+   BarPrefetcher * prefetcher = unwrapPointer<BarPrefetcher>(prefetcherIn, "bar prefetcher");
+   if(prefetcher->done()) return R_NilValue;
+
+   std::unique_ptr<BarStore> store;
+   std::string error;
+   while(!prefetcher->next(100, store, error)) Rcpp::checkUserInterrupt();
+
+   if(!store) Rcpp::stop(error);
+   return barStoreSession(std::move(store));
+}
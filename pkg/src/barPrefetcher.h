@@ -0,0 +1,85 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef BAR_PREFETCHER_H_INCLUDED
+#define BAR_PREFETCHER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "barStore.h"
+
+// Opens bar stores on background threads while the consumer works on the ones
+// opened earlier. The stores are handed out in the order of the paths and at
+// most capacity of them are opened ahead of the consumer - a bounded queue of
+// mapped stores, with their pages already read in.
+//
+// The workers don't call into R, only next() (called from R) waits on them.
+class BarPrefetcher {
+public:
+   BarPrefetcher(const std::vector<std::string> & paths, int capacity, int threads);
+   ~BarPrefetcher();
+
+   // The number of stores handed out so far
+   std::size_t consumed() const { return nextOut_; }
+   bool done() const { return nextOut_ == paths_.size(); }
+
+   // Waits up to milliseconds for the next store. Returns false on a timeout.
+   // Otherwise store is the next store, or NULL with the reason in error if it
+   // failed to open.
+   bool next(int milliseconds, std::unique_ptr<BarStore> & store, std::string & error);
+
+private:
+   BarPrefetcher(const BarPrefetcher &);
+   BarPrefetcher & operator=(const BarPrefetcher &);
+
+   struct Slot {
+      std::unique_ptr<BarStore> store;
+      std::string error;
+   };
+
+   void work();
+
+   std::vector<std::string> paths_;
+   std::size_t capacity_;
+
+   std::mutex mutex_;
+   std::condition_variable ready_;     // A store was opened
+   std::condition_variable space_;     // A store was consumed, or stopping
+   std::size_t nextTask_;              // The next path to open
+   std::size_t nextOut_;               // The next path to hand out
+   std::map<std::size_t, Slot> slots_; // Opened, not handed out yet
+   bool stop_;
+
+   std::vector<std::thread> threads_;
+};
+
+#endif // BAR_PREFETCHER_H_INCLUDED
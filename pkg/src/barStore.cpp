@@ -0,0 +1,210 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// No R headers in here - they don't mix with windows.h
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <climits>
+
+#include "barStore.h"
+
+const char BarStore::MAGIC[8] = { 'B', 'T', 'B', 'A', 'R', 'S', '\0', '\0' };
+
+BarStore::BarStore()
+   : header_(NULL), columns_(NULL), base_(NULL), length_(0)
+#ifdef _WIN32
+   , file_(INVALID_HANDLE_VALUE), mapping_(NULL)
+#else
+   , fd_(-1)
+#endif
+{}
+
+BarStore::~BarStore()
+{
+   close();
+}
+
+bool BarStore::open(const std::string & path, std::string & error)
+{
+   close();
+
+#ifdef _WIN32
+   file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if(file_ == INVALID_HANDLE_VALUE) {
+      error = "cannot open " + path;
+      return false;
+   }
+
+   LARGE_INTEGER size;
+   if(!GetFileSizeEx(file_, &size)) {
+      error = "cannot get the size of " + path;
+      close();
+      return false;
+   }
+   length_ = static_cast<std::size_t>(size.QuadPart);
+
+   if(length_ >= sizeof(BarStoreHeader)) {
+      mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+      if(mapping_ != NULL) base_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+      if(base_ == NULL) {
+         error = "cannot map " + path;
+         close();
+         return false;
+      }
+   }
+#else
+   fd_ = ::open(path.c_str(), O_RDONLY);
+   if(fd_ < 0) {
+      error = "cannot open " + path;
+      return false;
+   }
+
+   struct stat st;
+   if(fstat(fd_, &st) != 0) {
+      error = "cannot get the size of " + path;
+      close();
+      return false;
+   }
+   length_ = static_cast<std::size_t>(st.st_size);
+
+   if(length_ >= sizeof(BarStoreHeader)) {
+      base_ = mmap(NULL, length_, PROT_READ, MAP_SHARED, fd_, 0);
+      if(base_ == MAP_FAILED) {
+         base_ = NULL;
+         error = "cannot map " + path;
+         close();
+         return false;
+      }
+   }
+#endif
+
+   const BarStoreHeader * header = static_cast<const BarStoreHeader *>(base_);
+   if(header == NULL || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+      error = path + " is not a bar store";
+      close();
+      return false;
+   }
+
+   if(header->version != VERSION || header->columns != COLUMNS) {
+      error = path + " has an unsupported bar store version";
+      close();
+      return false;
+   }
+
+   if(header->rows < 0 || header->rows > INT_MAX ||
+         length_ != sizeof(BarStoreHeader) + static_cast<std::size_t>(header->rows)*COLUMNS*sizeof(double)) {
+      error = path + " is truncated or corrupt";
+      close();
+      return false;
+   }
+
+   header_ = header;
+   columns_ = reinterpret_cast<const double *>(header + 1);
+
+   // The sessions find the bars by a binary search over the times, like for the
+   // sessions built from an xts, the times must be in increasing order
+   const double * times = column(TIMES);
+   for(int ii = 1; ii < rows(); ++ii) {
+      if(!(times[ii-1] <= times[ii])) {
+         error = path + " has its times out of order";
+         close();
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void BarStore::close()
+{
+#ifdef _WIN32
+   if(base_ != NULL) UnmapViewOfFile(base_);
+   if(mapping_ != NULL) CloseHandle(mapping_);
+   if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+   mapping_ = NULL;
+   file_ = INVALID_HANDLE_VALUE;
+#else
+   if(base_ != NULL) munmap(base_, length_);
+   if(fd_ >= 0) ::close(fd_);
+   fd_ = -1;
+#endif
+   base_ = NULL;
+   length_ = 0;
+   header_ = NULL;
+   columns_ = NULL;
+}
+
+bool BarStore::write(
+         const std::string & path,
+         const double * const * columns,
+         int rows,
+         bool dateIndex,
+         std::string & error)
+{
+   BarStoreHeader header;
+   std::memset(&header, 0, sizeof(header));
+   std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+   header.version = VERSION;
+   header.columns = COLUMNS;
+   header.rows = rows;
+   header.dateIndex = dateIndex ? 1 : 0;
+
+   // Written to a temporary and renamed, a mapped reader never sees a partial file
+   std::string tmp = path + ".tmp";
+   FILE * file = std::fopen(tmp.c_str(), "wb");
+   if(file == NULL) {
+      error = "cannot create " + tmp;
+      return false;
+   }
+
+   bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+   for(int cc = 0; ok && cc < COLUMNS; ++cc) {
+      ok = rows == 0 || std::fwrite(columns[cc], sizeof(double), rows, file) == static_cast<std::size_t>(rows);
+   }
+   ok = std::fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+   ok = ok && MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+   ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+   if(!ok) {
+      std::remove(tmp.c_str());
+      error = "cannot write " + path;
+      return false;
+   }
+
+   return true;
+}
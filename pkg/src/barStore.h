@@ -0,0 +1,97 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef BAR_STORE_H_INCLUDED
+#define BAR_STORE_H_INCLUDED
+
+#include <string>
+#include <stdint.h>
+
+// The columnar bar store - a file per symbol with a header followed by the
+// columns, each an array of rows doubles in the native byte order:
+//
+//    times | open | high | low | close | volume | adjusted
+//
+// The times are the numeric xts index (seconds since the epoch), in increasing
+// order. The file is memory mapped and the columns are used in place, nothing
+// is parsed or copied.
+//
+// Nothing here calls into R, the errors are reported as strings, thus, a store
+// can be opened on any thread.
+
+struct BarStoreHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t columns;
+   int64_t rows;
+   uint32_t dateIndex;     // 1 if the index is a Date, 0 for POSIXct
+   char reserved[36];      // Pads the header to 64 bytes, the columns stay aligned
+};
+
+class BarStore {
+public:
+   enum Column { TIMES, OPEN, HIGH, LOW, CLOSE, VOLUME, ADJUSTED, COLUMNS };
+
+   static const char MAGIC[8];
+   static const uint32_t VERSION = 1;
+
+   BarStore();
+   ~BarStore();
+
+   // Maps the file, returns false (with the reason in error) on failure
+   bool open(const std::string & path, std::string & error);
+   void close();
+
+   bool isOpen() const { return header_ != NULL; }
+   int rows() const { return static_cast<int>(header_->rows); }
+   bool dateIndex() const { return header_->dateIndex != 0; }
+   const double * column(Column cc) const { return columns_ + static_cast<int64_t>(cc)*header_->rows; }
+
+   // columns holds the COLUMNS arrays in the order of Column
+   static bool write(
+         const std::string & path,
+         const double * const * columns,
+         int rows,
+         bool dateIndex,
+         std::string & error);
+
+private:
+   BarStore(const BarStore &);
+   BarStore & operator=(const BarStore &);
+
+   const BarStoreHeader * header_;
+   const double * columns_;
+   void * base_;
+   std::size_t length_;
+#ifdef _WIN32
+   void * file_;
+   void * mapping_;
+#else
+   int fd_;
+#endif
+};
+
+#endif // BAR_STORE_H_INCLUDED
@@ -0,0 +1,357 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+#include <memory>
+#include <string>
+
+#include "common.h"
+#include "processTrades.h"
+#include "parallel.h"
+#include "performance.h"
+#include "rangeIndex.h"
+#include "runs.h"
+#include "session.h"
+
+using namespace Rcpp;
+
+// One symbol of a batch backtest, converted and validated on the main thread.
+// The trades come either from an indicator (dense or its runs) with the same
+// settings for all trades, or from a trade list with per-trade settings. The
+// workers see only the borrowed columns and the plain vectors.
+struct BatchSymbol {
+   Rcpp::NumericMatrix matrix;
+   Ohlc ohlc;
+
+   // A session's index, if already built, is shared by all symbols using the
+   // session. Otherwise, the worker builds its own when it pays off.
+   const RangeIndex * sessionIndex;
+
+   bool fromIndicator;
+   Rcpp::NumericVector indicator;
+   const double * indicatorValues;
+   IndicatorRuns runs;
+   bool hasRuns;
+
+   // The trades, 0 based, and their settings
+   std::vector<int> ibeg;
+   std::vector<int> iend;
+   std::vector<int> position;
+   std::vector<double> stopLoss;
+   std::vector<double> stopTrailing;
+   std::vector<double> profitTarget;
+   std::vector<int> maxDays;
+
+   // The output - the trades, or their statistics for a summary
+   std::vector<int> iendOut;
+   std::vector<double> exitPrice;
+   std::vector<double> gain;
+   std::vector<double> minPrice;
+   std::vector<double> maxPrice;
+   std::vector<double> mae;
+   std::vector<double> mfe;
+   std::vector<int> reason;
+
+   ReturnStats returnStats;
+   TradeStats tradeStats;
+
+   BatchSymbol() : sessionIndex(NULL), fromIndicator(false), indicatorValues(NULL), hasRuns(false) {}
+};
+
+void batchSymbol(SEXP symbolIn, std::size_t ss, BatchSymbol & symbol)
+{
+   std::string name = "symbol " + std::to_string(ss + 1) + ": ";
+   Rcpp::List spec(symbolIn);
+
+   SEXP ohlcIn = spec["ohlc"];
+   BarSession * session = barSession(ohlcIn);
+   if(session != NULL) {
+      symbol.ohlc = session->ohlc();
+      symbol.sessionIndex = session->builtRangeIndex();
+   } else {
+      symbol.matrix = Rcpp::NumericMatrix(ohlcIn);
+      symbol.ohlc = ohlcFromMatrix(symbol.matrix);
+   }
+
+   if(spec.containsElementNamed("indicator")) {
+      symbol.fromIndicator = true;
+      SEXP indicatorIn = spec["indicator"];
+      int size;
+      if(isRle(indicatorIn)) {
+         runsFromRle(indicatorIn, symbol.runs);
+         symbol.hasRuns = true;
+         size = symbol.runs.size;
+      } else {
+         symbol.indicator = Rcpp::NumericVector(indicatorIn);
+         symbol.indicatorValues = symbol.indicator.begin();
+         size = symbol.indicator.size();
+      }
+
+      if(size != symbol.ohlc.size) {
+         Rcpp::stop(name + "the indicator and the ohlc must have the same number of bars");
+      }
+      return;
+   }
+
+   symbol.ibeg = Rcpp::as< std::vector<int> >(spec["entry"]);
+   symbol.iend = Rcpp::as< std::vector<int> >(spec["exit"]);
+   symbol.position = Rcpp::as< std::vector<int> >(spec["position"]);
+   symbol.stopLoss = Rcpp::as< std::vector<double> >(spec["stop.loss"]);
+   symbol.stopTrailing = Rcpp::as< std::vector<double> >(spec["stop.trailing"]);
+   symbol.profitTarget = Rcpp::as< std::vector<double> >(spec["profit.target"]);
+   symbol.maxDays = Rcpp::as< std::vector<int> >(spec["max.days"]);
+
+   std::size_t trades = symbol.ibeg.size();
+   if(symbol.iend.size() != trades || symbol.position.size() != trades ||
+         symbol.stopLoss.size() != trades || symbol.stopTrailing.size() != trades ||
+         symbol.profitTarget.size() != trades || symbol.maxDays.size() != trades) {
+      Rcpp::stop(name + "the trade vectors must have the same length");
+   }
+
+   // vectors in c++ are zero based and in R are one based. the workers don't
+   // check the indexes, do it here.
+   for(std::size_t ii = 0; ii < trades; ++ii) {
+      if(symbol.ibeg[ii] == NA_INTEGER || symbol.iend[ii] == NA_INTEGER) {
+         Rcpp::stop(name + "the trades must be within the bars, entry before exit");
+      }
+      symbol.ibeg[ii] -= 1;
+      symbol.iend[ii] -= 1;
+      if(symbol.ibeg[ii] < 0 || symbol.ibeg[ii] > symbol.iend[ii] || symbol.iend[ii] >= symbol.ohlc.size) {
+         Rcpp::stop(name + "the trades must be within the bars, entry before exit");
+      }
+   }
+}
+
+// Runs on a worker thread: the trades of the symbol, and their statistics for a summary
+void backtestSymbol(
+         BatchSymbol & symbol,
+         double stopLoss,
+         double stopTrailing,
+         double profitTarget,
+         int maxDays,
+         double tickSize,
+         bool inDollars,
+         bool summary)
+{
+   const Ohlc & ohlc = symbol.ohlc;
+
+   if(symbol.fromIndicator) {
+      if(symbol.hasRuns) {
+         tradesFromRuns(symbol.runs, symbol.ibeg, symbol.iend, symbol.position);
+      } else {
+         tradesFromIndicator(symbol.indicatorValues, ohlc.size, symbol.ibeg, symbol.iend, symbol.position);
+      }
+
+      // The settings are the same for all trades
+      std::size_t trades = symbol.ibeg.size();
+      symbol.stopLoss.assign(trades, stopLoss);
+      symbol.stopTrailing.assign(trades, stopTrailing);
+      symbol.profitTarget.assign(trades, profitTarget);
+      symbol.maxDays.assign(trades, maxDays);
+   }
+
+   // Only the trades without a trailing stop benefit from the range index
+   const RangeIndex * index = symbol.sessionIndex;
+   std::unique_ptr<RangeIndex> ownIndex;
+   if(index == NULL) {
+      double bars = 0;
+      for(std::vector<int>::size_type ii = 0; ii < symbol.ibeg.size(); ++ii) {
+         if(isNA(symbol.stopTrailing[ii])) bars += symbol.iend[ii] - symbol.ibeg[ii];
+      }
+      if(RangeIndex::worthwhile(ohlc.size, bars)) {
+         ownIndex.reset(new RangeIndex(ohlc));
+         index = ownIndex.get();
+      }
+   }
+
+   processTrades(
+         ohlc,
+         symbol.ibeg, symbol.iend, symbol.position,
+         symbol.stopLoss, symbol.stopTrailing, symbol.profitTarget, symbol.maxDays, tickSize,
+         symbol.iendOut, symbol.exitPrice, symbol.gain, symbol.minPrice, symbol.maxPrice,
+         symbol.mae, symbol.mfe, symbol.reason, index);
+
+   if(!summary) return;
+
+   std::vector<double> returns;
+   calculateReturns(ohlc.cl, ohlc.size, symbol.ibeg, symbol.iendOut, symbol.position, symbol.exitPrice, inDollars, returns);
+   for(std::vector<double>::size_type ii = 0; ii < returns.size(); ++ii) {
+      symbol.returnStats.add(returns[ii]);
+   }
+
+   for(std::vector<int>::size_type ii = 0; ii < symbol.ibeg.size(); ++ii) {
+      symbol.tradeStats.add(symbol.gain[ii], symbol.mae[ii], symbol.mfe[ii], symbol.reason[ii]);
+   }
+
+   // Only the statistics are kept
+   std::vector<int>().swap(symbol.ibeg);
+   std::vector<int>().swap(symbol.iend);
+   std::vector<int>().swap(symbol.position);
+   std::vector<double>().swap(symbol.stopLoss);
+   std::vector<double>().swap(symbol.stopTrailing);
+   std::vector<double>().swap(symbol.profitTarget);
+   std::vector<int>().swap(symbol.maxDays);
+   std::vector<int>().swap(symbol.iendOut);
+   std::vector<double>().swap(symbol.exitPrice);
+   std::vector<double>().swap(symbol.gain);
+   std::vector<double>().swap(symbol.minPrice);
+   std::vector<double>().swap(symbol.maxPrice);
+   std::vector<double>().swap(symbol.mae);
+   std::vector<double>().swap(symbol.mfe);
+   std::vector<int>().swap(symbol.reason);
+}
+
+// The trades of a symbol, in the process.trades format, 1 based
+Rcpp::DataFrame batchTrades(BatchSymbol & symbol)
+{
+   for(std::vector<int>::size_type ii = 0; ii < symbol.ibeg.size(); ++ii) {
+      symbol.ibeg[ii] += 1;
+      symbol.iendOut[ii] += 1;
+   }
+
+   return Rcpp::DataFrame::create(
+               Rcpp::Named("Entry") = symbol.ibeg,
+               Rcpp::Named("Exit") = symbol.iendOut,
+               Rcpp::Named("Position") = symbol.position,
+               Rcpp::Named("StopLoss") = symbol.stopLoss,
+               Rcpp::Named("StopTrailing") = symbol.stopTrailing,
+               Rcpp::Named("ProfitTarget") = symbol.profitTarget,
+               Rcpp::Named("ExitPrice") = symbol.exitPrice,
+               Rcpp::Named("Gain") = symbol.gain,
+               Rcpp::Named("MinPrice") = symbol.minPrice,
+               Rcpp::Named("MaxPrice") = symbol.maxPrice,
+               Rcpp::Named("MAE") = symbol.mae,
+               Rcpp::Named("MFE") = symbol.mfe,
+               Rcpp::Named("Reason") = symbol.reason);
+}
+
+// One row per symbol: the performance statistics followed by the number of trades
+// per exit reason
+Rcpp::List batchSummary(const std::vector<BatchSymbol> & symbols, double periods)
+{
+   std::size_t rows = symbols.size();
+   Rcpp::IntegerVector barsOut(rows);
+   Rcpp::IntegerVector tradesOut(rows);
+   Rcpp::NumericVector cagrOut(rows);
+   Rcpp::NumericVector volatilityOut(rows);
+   Rcpp::NumericVector sharpeOut(rows);
+   Rcpp::NumericVector sortinoOut(rows);
+   Rcpp::NumericVector drawdownOut(rows);
+   Rcpp::IntegerVector drawdownBarsOut(rows);
+   Rcpp::NumericVector winRateOut(rows);
+   Rcpp::NumericVector profitFactorOut(rows);
+   Rcpp::NumericVector maeOut(rows);
+   Rcpp::NumericVector mfeOut(rows);
+   std::vector<Rcpp::IntegerVector> reasonsOut;
+   for(int rr = 0; rr < EXIT_REASONS; ++rr) reasonsOut.push_back(Rcpp::IntegerVector(rows));
+
+   for(std::size_t ss = 0; ss < rows; ++ss) {
+      const ReturnStats & returns = symbols[ss].returnStats;
+      const TradeStats & trades = symbols[ss].tradeStats;
+      barsOut[ss] = symbols[ss].ohlc.size;
+      tradesOut[ss] = trades.trades;
+      cagrOut[ss] = returns.cagr(periods);
+      volatilityOut[ss] = returns.volatility(periods);
+      sharpeOut[ss] = returns.sharpe(periods);
+      sortinoOut[ss] = returns.sortino(periods);
+      drawdownOut[ss] = returns.maxDrawdown;
+      drawdownBarsOut[ss] = returns.maxDrawdownBars;
+      winRateOut[ss] = trades.winRate();
+      profitFactorOut[ss] = trades.profitFactor();
+      maeOut[ss] = trades.averageMae();
+      mfeOut[ss] = trades.averageMfe();
+      for(int rr = 0; rr < EXIT_REASONS; ++rr) reasonsOut[rr][ss] = trades.reasons[rr];
+   }
+
+   // More columns than DataFrame::create takes - build the list by hand
+   Rcpp::List res(12 + EXIT_REASONS);
+   Rcpp::CharacterVector names(res.size());
+   int cc = 0;
+   names[cc] = "Bars"; res[cc++] = barsOut;
+   names[cc] = "Trades"; res[cc++] = tradesOut;
+   names[cc] = "CAGR"; res[cc++] = cagrOut;
+   names[cc] = "Volatility"; res[cc++] = volatilityOut;
+   names[cc] = "Sharpe"; res[cc++] = sharpeOut;
+   names[cc] = "Sortino"; res[cc++] = sortinoOut;
+   names[cc] = "MaxDrawdown"; res[cc++] = drawdownOut;
+   names[cc] = "MaxDrawdownBars"; res[cc++] = drawdownBarsOut;
+   names[cc] = "WinRate"; res[cc++] = winRateOut;
+   names[cc] = "ProfitFactor"; res[cc++] = profitFactorOut;
+   names[cc] = "AvgMAE"; res[cc++] = maeOut;
+   names[cc] = "AvgMFE"; res[cc++] = mfeOut;
+   for(int rr = 0; rr < EXIT_REASONS; ++rr) {
+      names[cc] = EXIT_REASON_NAMES[rr];
+      res[cc++] = reasonsOut[rr];
+   }
+   res.attr("names") = names;
+
+   return res;
+}
+
+// Backtests a list of symbols in a single call. Each element of symbolsIn is a
+// list with the ohlc (a matrix or a bar session) and either an indicator aligned
+// with it (dense or an "rle") or a trade list - entry, exit, position (1 based)
+// and the per-trade stop.loss, stop.trailing, profit.target and max.days. The
+// settings apply to the trades of the indicators.
+//
+// The histories vary a lot in length, thus, the symbols are scheduled by their
+// number of bars on a work stealing pool. Returns a list with the trades of each
+// symbol, or with summary, the columns of a data frame with a row per symbol.
+// [[Rcpp::export("backtest.symbols.interface")]]
+Rcpp::List backtestSymbolsInterface(
+                     SEXP symbolsIn,
+                     double stopLoss,
+                     double stopTrailing,
+                     double profitTarget,
+                     int maxDays,
+                     double tickSize,
+                     bool inDollars,
+                     bool summary,
+                     double periods,
+                     int threads)
+{
+   Rcpp::List symbolsList(symbolsIn);
+   std::vector<BatchSymbol> symbols(symbolsList.size());
+   for(std::size_t ss = 0; ss < symbols.size(); ++ss) {
+      batchSymbol(symbolsList[ss], ss, symbols[ss]);
+   }
+
+   parallelForStealing(
+         symbols.size(),
+         threads,
+         [&symbols](std::size_t ss) { return double(symbols[ss].ohlc.size); },
+         [&](std::size_t ss, int) {
+            backtestSymbol(symbols[ss], stopLoss, stopTrailing, profitTarget, maxDays, tickSize, inDollars, summary);
+         });
+
+   if(summary) return batchSummary(symbols, periods);
+
+   Rcpp::List res(symbols.size());
+   for(std::size_t ss = 0; ss < symbols.size(); ++ss) {
+      res[ss] = batchTrades(symbols[ss]);
+   }
+   return res;
+}
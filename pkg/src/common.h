@@ -27,6 +27,8 @@
 #ifndef COMMON_H_INCLUDED
 #define COMMON_H_INCLUDED
 
+#include <string>
+
 #include <Rcpp.h>
 
 // This needs to be changed if the c++ code is used outside R.
@@ -52,4 +54,30 @@ template <typename T> inline int sign(T t) {
    return (T(0) < t) - (t < T(0));
 }
 
+// The objects handed to R through external pointers are tagged with the name of
+// their type. Thus, passing one kind of object where another is expected is an
+// error, not a bad cast.
+template <typename T>
+SEXP wrapPointer(T * object, const char * type)
+{
+   return Rcpp::XPtr<T>(object, true, Rf_install(type));
+}
+
+inline bool isPointer(SEXP in, const char * type)
+{
+   return TYPEOF(in) == EXTPTRSXP && R_ExternalPtrTag(in) == Rf_install(type);
+}
+
+// The object behind an external pointer of the type. Fails for anything else, and
+// for the pointers which didn't survive a save and restore.
+template <typename T>
+T * unwrapPointer(SEXP in, const char * type)
+{
+   if(!isPointer(in, type)) Rcpp::stop(std::string("expected a ") + type);
+
+   T * object = static_cast<T *>(R_ExternalPtrAddr(in));
+   if(object == NULL) Rcpp::stop(std::string("the ") + type + " is no longer valid (was it saved and restored?)");
+   return object;
+}
+
 #endif // COMMON_H_INCLUDED
\ No newline at end of file
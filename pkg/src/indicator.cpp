@@ -26,6 +26,11 @@
 
 #include <Rcpp.h>
 #include "common.h"
+#include "session.h"
+#include "zigZag.h"
+#include "parallel.h"
+#include "runs.h"
+#include "signals.h"
 
 using namespace Rcpp;
 
@@ -103,8 +108,9 @@ void capTradeDuration(
    }
 }
 
+// The indicator is either dense or its runs, the result is in the same form
 // [[Rcpp::export("cap.trade.duration.interface")]]
-Rcpp::NumericVector capTradeDurationInterface(
+SEXP capTradeDurationInterface(
                         SEXP indicatorIn,
                         int shortMinCap,
                         int longMinCap,
@@ -112,6 +118,14 @@ Rcpp::NumericVector capTradeDurationInterface(
                         int longMaxCap,
                         bool waitNewSignal)
 {
+   // The runs are capped without expanding them
+   if(isRle(indicatorIn)) {
+      IndicatorRuns runs, capped;
+      runsFromRle(indicatorIn, runs);
+      capTradeDuration(runs, shortMinCap, longMinCap, shortMaxCap, longMaxCap, waitNewSignal, capped);
+      return rleFromRuns(capped);
+   }
+
    // Convert ohlc into std vectors
    std::vector<double> indicator = Rcpp::as< std::vector<double> >(indicatorIn);
    capTradeDuration(
@@ -125,105 +139,218 @@ Rcpp::NumericVector capTradeDurationInterface(
    return Rcpp::NumericVector(indicator.begin(), indicator.end());
 }
 
-void constructIndicator(
-         const std::vector<bool> & longEntries,
-         const std::vector<bool> & longExits,
-         const std::vector<bool> & shortEntries,
-         const std::vector<bool> & shortExits,
-         std::vector<double> & indicator)
+// Trades for a grid of caps, the combination kk is (shortMinCaps[kk], longMinCaps[kk],
+// shortMaxCaps[kk], longMaxCaps[kk]). The indicator is either dense or its runs. The
+// runs are extracted once, each combination caps them and emits its trades, tagged
+// by the 1 based combination in Param.
+// [[Rcpp::export("cap.trade.duration.grid.interface")]]
+Rcpp::List capTradeDurationGridInterface(
+                        SEXP indicatorIn,
+                        SEXP shortMinCapsIn,
+                        SEXP longMinCapsIn,
+                        SEXP shortMaxCapsIn,
+                        SEXP longMaxCapsIn,
+                        bool waitNewSignal,
+                        int threads)
 {
-   indicator.resize(longEntries.size(), 0.0);
+   std::vector<int> shortMinCaps = Rcpp::as< std::vector<int> >(shortMinCapsIn);
+   std::vector<int> longMinCaps = Rcpp::as< std::vector<int> >(longMinCapsIn);
+   std::vector<int> shortMaxCaps = Rcpp::as< std::vector<int> >(shortMaxCapsIn);
+   std::vector<int> longMaxCaps = Rcpp::as< std::vector<int> >(longMaxCapsIn);
 
-   std::vector<double>::size_type ii = 0;
+   std::size_t combinations = shortMinCaps.size();
+   if(longMinCaps.size() != combinations || shortMaxCaps.size() != combinations || longMaxCaps.size() != combinations) {
+      Rcpp::stop("the cap vectors must have the same length");
+   }
+
+   IndicatorRuns runs;
+   if(isRle(indicatorIn)) {
+      runsFromRle(indicatorIn, runs);
+   } else {
+      Rcpp::NumericVector indicator(indicatorIn);
+      runsFromDense(indicator.begin(), indicator.size(), runs);
+   }
 
-   while(ii < indicator.size() && !longEntries[ii] && !shortEntries[ii]) ++ii;
+   std::vector< std::vector<int> > ibegs(combinations), iends(combinations), positions(combinations);
+   int workers = threadCount(threads, combinations);
+   std::vector<IndicatorRuns> capped(workers);
+   parallelFor(combinations, workers, [&](std::size_t kk, int worker) {
+      capTradeDuration(
+            runs,
+            shortMinCaps[kk],
+            longMinCaps[kk],
+            shortMaxCaps[kk],
+            longMaxCaps[kk],
+            waitNewSignal,
+            capped[worker]);
+      tradesFromRuns(capped[worker], ibegs[kk], iends[kk], positions[kk]);
+   });
+
+   std::size_t total = 0;
+   for(std::size_t kk = 0; kk < combinations; ++kk) total += ibegs[kk].size();
+
+   Rcpp::IntegerVector paramOut(total), ibegOut(total), iendOut(total), positionOut(total);
+   std::size_t jj = 0;
+   for(std::size_t kk = 0; kk < combinations; ++kk) {
+      for(std::size_t ii = 0; ii < ibegs[kk].size(); ++ii, ++jj) {
+         // Convert to 1 based indexes on the way out
+         paramOut[jj] = kk + 1;
+         ibegOut[jj] = ibegs[kk][ii] + 1;
+         iendOut[jj] = iends[kk][ii] + 1;
+         positionOut[jj] = positions[kk][ii];
+      }
+   }
+
+   return Rcpp::List::create(
+               Rcpp::Named("Param") = paramOut,
+               Rcpp::Named("Entry") = ibegOut,
+               Rcpp::Named("Exit") = iendOut,
+               Rcpp::Named("Position") = positionOut);
+}
 
+// Appends the position at each bar to output - a DenseOutput or IndicatorRuns.
+// The position changes only at a signal, thus, the words without signals are
+// appended at once and the rest are scanned one signal at a time.
+template <typename Output>
+void constructIndicator(
+         const PackedSignals & longEntries,
+         const PackedSignals & longExits,
+         const PackedSignals & shortEntries,
+         const PackedSignals & shortExits,
+         Output & output)
+{
    int pos = 0;
-   while(ii < indicator.size()) {
-      switch(pos) {
-         case -1:
-            if(longEntries[ii]) pos = 1;
-            else if(shortExits[ii]) pos = 0;
-            break;
-            
-         case 0:
-            if(longEntries[ii]) pos = 1;
-            else if(shortEntries[ii]) pos = -1;
-            break;
-            
-         case 1:
-            if(shortEntries[ii]) pos = -1;
-            else if(longExits[ii]) pos = 0;
-            break;
+   int next = 0;     // The first bar not in output yet
+   for(std::vector<uint64_t>::size_type ww = 0; ww < longEntries.words.size(); ++ww) {
+      uint64_t le = longEntries.words[ww];
+      uint64_t lx = longExits.words[ww];
+      uint64_t se = shortEntries.words[ww];
+      uint64_t sx = shortExits.words[ww];
+
+      for(uint64_t signals = le | lx | se | sx; signals != 0; signals &= signals - 1) {
+         int bit = lowestBit(signals);
+         int ii = ww*64 + bit;
+         output.append(pos, ii - next);
+
+         uint64_t mask = uint64_t(1) << bit;
+         switch(pos) {
+            case -1:
+               if(le & mask) pos = 1;
+               else if(sx & mask) pos = 0;
+               break;
+               
+            case 0:
+               if(le & mask) pos = 1;
+               else if(se & mask) pos = -1;
+               break;
+               
+            case 1:
+               if(se & mask) pos = -1;
+               else if(lx & mask) pos = 0;
+               break;
+         }
+
+         output.append(pos, 1);
+         next = ii + 1;
       }
-      
-      indicator[ii++] = pos;
    }
+
+   output.append(pos, longEntries.size - next);
 }
 
+// The signals are either logical vectors or packed ones. Returns the runs of the
+// indicator (an "rle" object) if runs is true.
 // [[Rcpp::export("construct.indicator.interface")]]
-Rcpp::NumericVector constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn)
+SEXP constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn, bool runs)
 {
-   std::vector<bool> longEntries = Rcpp::as<std::vector<bool> >(longEntriesIn);
-   std::vector<bool> longExits  = Rcpp::as<std::vector<bool> >(longExitsIn);
-   std::vector<bool> shortEntries = Rcpp::as<std::vector<bool> >(shortEntriesIn);
-   std::vector<bool> shortExits  = Rcpp::as<std::vector<bool> >(shortExitsIn);
+   PackedSignals longEntries, longExits, shortEntries, shortExits;
+   signalsFromArg(longEntriesIn, longEntries);
+   signalsFromArg(longExitsIn, longExits);
+   signalsFromArg(shortEntriesIn, shortEntries);
+   signalsFromArg(shortExitsIn, shortExits);
+
+   int size = longEntries.size;
+   if(longExits.size != size || shortEntries.size != size || shortExits.size != size) {
+      Rcpp::stop("the entries and the exits must have the same length");
+   }
    
-   std::vector<double> indicator;
-   constructIndicator(longEntries, longExits, shortEntries, shortExits, indicator);
+   if(runs) {
+      IndicatorRuns indicator;
+      constructIndicator(longEntries, longExits, shortEntries, shortExits, indicator);
+      return rleFromRuns(indicator);
+   }
 
-   return Rcpp::NumericVector(indicator.begin(), indicator.end());
+   Rcpp::NumericVector indicator(size);
+   DenseOutput output = { indicator.begin() };
+   constructIndicator(longEntries, longExits, shortEntries, shortExits, output);
+   return indicator;
 }
 
-void indicatorFromTrendline(const std::vector<double> & trendline, const std::vector<double> & thresholds, std::vector<int> & indicator)
+// The thresholds of a single column
+struct ColumnThresholds {
+   const double * column;
+   double operator()(int ii) const { return column[ii]; }
+};
+
+// A base vector of thresholds scaled by a multiplier
+struct ScaledThresholds {
+   const double * base;
+   double multiplier;
+   double operator()(int ii) const { return base[ii]*multiplier; }
+};
+
+// thresholds(ii) is the threshold at bar ii. The indicator is written as doubles,
+// straight into the R result.
+template <typename Thresholds>
+void indicatorFromTrendline(const double * trendline, int size, Thresholds thresholds, double * indicator)
 {
-   indicator.resize(trendline.size(), 0);
+   std::fill(indicator, indicator + size, 0.0);
 
-   std::vector<double>::size_type ii = 0;
-   while(ii < trendline.size() && (isNA(trendline[ii]) || isNA(thresholds[ii]))) {
+   int ii = 0;
+   while(ii < size && (isNA(trendline[ii]) || isNA(thresholds(ii)))) {
       ++ii;
    }
 
    ++ii;
 
-   if(ii >= trendline.size()) return;
+   if(ii >= size) return;
 
    int id = ii;
    int direction = sign(trendline[ii] - trendline[ii-1]);
-   double threshold = trendline[ii] - thresholds[ii]*direction;
+   double threshold = trendline[ii] - thresholds(ii)*direction;
    indicator[ii] = direction;
-   for(++ii; ii < trendline.size(); ++ii) {
+   for(++ii; ii < size; ++ii) {
       if(direction == -1) {
          if(trendline[ii] <= trendline[id]) {
             // A new minimum, reset
             id = ii;
-            threshold = trendline[ii] + thresholds[ii];
+            threshold = trendline[ii] + thresholds(ii);
          } else if(trendline[ii] >= threshold) {
             // Trend reversal
             id = ii;
-            threshold = trendline[ii] - thresholds[ii];
+            threshold = trendline[ii] - thresholds(ii);
             direction = 1;
          }
       } else if(direction == 1) {
          if(trendline[ii] >= trendline[id]) {
             // A new maximum, reset
             id = ii;
-            threshold = trendline[ii] - thresholds[ii];
+            threshold = trendline[ii] - thresholds(ii);
          } else if(trendline[ii] <= threshold) {
             // Trend reversal
             id = ii;
-            threshold = trendline[ii] + thresholds[ii];
+            threshold = trendline[ii] + thresholds(ii);
             direction = -1;
          }
       } else {
          if(trendline[ii] > trendline[ii-1]) {
             id = ii;
             direction = 1;
-            threshold = trendline[ii] - thresholds[ii];
+            threshold = trendline[ii] - thresholds(ii);
          } else if(trendline[ii] < trendline[ii-1]) {
             id = ii;
             direction = -1;
-            threshold = trendline[ii] + thresholds[ii];
+            threshold = trendline[ii] + thresholds(ii);
          }
       }
       indicator[ii] = direction;
@@ -233,17 +360,60 @@ void indicatorFromTrendline(const std::vector<double> & trendline, const std::ve
 // [[Rcpp::export("indicator.from.trendline.interface")]]
 Rcpp::NumericVector indicatorFromTrendlineInterface(SEXP trendlineIn, SEXP thresholdsIn)
 {
-   std::vector<double> trendline = Rcpp::as<std::vector<double> >(trendlineIn);
-   std::vector<double> thresholds  = Rcpp::as<std::vector<double> >(thresholdsIn);
+   Rcpp::NumericVector trendline(trendlineIn);
+   Rcpp::NumericVector thresholds(thresholdsIn);
    
-   std::vector<int> indicator;
-   indicatorFromTrendline(trendline, thresholds, indicator);
+   Rcpp::NumericVector indicator(trendline.size());
+   ColumnThresholds columnThresholds = { thresholds.begin() };
+   indicatorFromTrendline(trendline.begin(), trendline.size(), columnThresholds, indicator.begin());
 
-   return Rcpp::NumericVector(indicator.begin(), indicator.end());
+   return indicator;
+}
+
+// An indicator column per threshold column, the columns are spread over the threads.
+// thresholdsIn is either a matrix with a row per bar, or a base vector of thresholds
+// which is scaled by each of the multipliers.
+// [[Rcpp::export("indicator.from.trendline.batch.interface")]]
+Rcpp::NumericMatrix indicatorFromTrendlineBatchInterface(SEXP trendlineIn, SEXP thresholdsIn, SEXP multipliersIn, int threads)
+{
+   Rcpp::NumericVector trendline(trendlineIn);
+   Rcpp::NumericVector thresholds(thresholdsIn);
+   int size = trendline.size();
+
+   const double * tl = trendline.begin();
+   const double * th = thresholds.begin();
+
+   if(Rf_isNull(multipliersIn)) {
+      if(!Rf_isMatrix(thresholds) || Rf_nrows(thresholds) != size) {
+         Rcpp::stop("the thresholds must be a matrix with a row per bar");
+      }
+
+      Rcpp::NumericMatrix res(size, Rf_ncols(thresholds));
+      double * out = res.begin();
+      parallelFor(res.ncol(), threads, [=](std::size_t cc, int) {
+         ColumnThresholds columnThresholds = { th + cc*size };
+         indicatorFromTrendline(tl, size, columnThresholds, out + cc*size);
+      });
+
+      return res;
+   }
+
+   if(thresholds.size() != size) Rcpp::stop("the thresholds must have the same length as the trendline");
+
+   std::vector<double> multipliers = Rcpp::as< std::vector<double> >(multipliersIn);
+   Rcpp::NumericMatrix res(size, (int)multipliers.size());
+   double * out = res.begin();
+   parallelFor(multipliers.size(), threads, [&, out](std::size_t cc, int) {
+      ScaledThresholds scaledThresholds = { th, multipliers[cc] };
+      indicatorFromTrendline(tl, size, scaledThresholds, out + cc*size);
+   });
+
+   return res;
 }
 
 void zigZag(
-         const std::vector<double> & close,
+         const double * close,
+         int len,
          const std::vector<double> & changes,
          bool percent,
          std::vector<int> & indicator,
@@ -252,149 +422,44 @@ void zigZag(
          std::vector<double> & corrections,
          std::vector<int> & age)
 {
-   int len = close.size();
-   
-   indicator.resize(len, 0);
-   inflections.resize(len, NA_REAL);
-   corrections.resize(len, 0);
-   targets.resize(len, NA_REAL);
-   age.resize(len, 0);
-   
-   int ii = 0;
-   // Skip all NAs in the changes vector
-   while(ii < len && isNA(changes[ii])) ++ii;
-   
-   if(ii >= len) return;
-   
-   int state = 0;
-   int jj = ii;
-   double target = changes[jj];
-   
-   // Find the first up or down state
-   for(++ii; ii < len; ++ii) {
-      if(percent) {
-         double pct = close[ii]/close[jj] - 1.0;
-         if(pct > target) {
-            state = 1;
-            break;
-         }
-         
-         pct = 1.0 - close[ii]/close[jj];
-         if(pct > target) {
-            state = -1;
-            break;
-         }
-      } else {
-         double cash = close[ii] - close[jj];
-         if(cash > target) {
-            state = 1;
-            break;
-         }
-         
-         cash = close[jj] - close[ii];
-         if(cash > target) {
-            state = -1;
-            break;
-         }
-      }
-   }
-   
-   if(ii < len) {
-      jj = ii;
-      target = changes[jj];
-      inflections[ii] = close[ii];
-      indicator[ii] = state;
-      targets[ii] = target;
+   indicator.resize(len);
+   inflections.resize(len);
+   corrections.resize(len);
+   targets.resize(len);
+   age.resize(len);
+
+   ZigZag zz(percent);
+   for(int ii = 0; ii < len; ++ii) {
+      zz.step(close[ii], changes[ii], indicator[ii], inflections[ii], targets[ii], corrections[ii], age[ii]);
    }
-   
-   // The main loop
-   for(++ii; ii < len; ++ii) {
-      if(state == 1) {
-         if(close[ii] >= close[jj]) {
-            indicator[ii] = 1;
-            age[ii] = age[ii-1] + 1;
-            inflections[ii] = inflections[ii-1];
-            target = changes[ii];
-            targets[ii] = changes[ii];
-            jj = ii;
-         } else {
-            bool newTrend = false;
-            double change;
-            if(percent) {
-               change = 1.0 - close[ii]/close[jj];
-               if(change > target) {
-                  newTrend = true;
-               }
-            } else {
-               change = close[jj] - close[ii];
-               if(change > target) {
-                  newTrend = true;
-               }
-            }
-            
-            if(newTrend) {
-               // Change in state
-               for(int kk = jj + 1; kk < ii; ++kk) {
-                  indicator[kk] = 1;
-               }
-               indicator[ii] = -1;
-               age[ii] = 0;
-               inflections[ii] = close[ii];
-               state = -1;
-               jj = ii;
-               targets[ii] = changes[jj];
-               target = changes[jj];
-            } else {
-               indicator[ii] = 1;
-               age[ii] = age[ii-1] + 1;
-               inflections[ii] = inflections[ii-1];
-               corrections[ii] = change;
-               targets[ii] = targets[ii-1];
-            }
-         }
-      } else {
-         if(close[ii] <= close[jj]) {
-            indicator[ii] = -1;
-            age[ii] = age[ii-1] + 1;
-            inflections[ii] = inflections[ii-1];
-            target = changes[ii];
-            targets[ii] = changes[ii];
-            jj = ii;
-         } else {
-            bool newTrend = false;
-            double change;
-            if(percent) {
-               change = close[ii]/close[jj] - 1.0;
-               if(change > target) {
-                  newTrend = true;
-               }
-            } else {
-               change = close[ii] - close[jj];
-               if(change > target) {
-                  newTrend = true;
-               }
-            }
-            
-            if(newTrend) {
-               // Change in state
-               for(int kk = jj + 1; kk < ii; ++kk) {
-                  indicator[kk] = -1;
-               }
-               indicator[ii] = 1;
-               age[ii] = 0;
-               inflections[ii] = close[ii];
-               state = 1;
-               jj = ii;
-               target = changes[jj];
-               targets[ii] = target;
-            } else {
-               indicator[ii] = -1;
-               age[ii] = age[ii-1] + 1;
-               inflections[ii] = inflections[ii-1];
-               corrections[ii] = change;
-               targets[ii] = targets[ii-1];
-            }
-         }
+}
+
+// Zig-zags for several thresholds in a single pass over the prices. The threshold
+// of zig-zag kk at bar ii is changes[kk*columnStride + ii*barStride] - a column
+// major matrix has a bar stride of 1 and a column stride of len, constant
+// thresholds have a bar stride of 0 and a column stride of 1. The outputs are
+// column major len x count matrices, a column per threshold.
+void zigZagMulti(
+         const double * close,
+         int len,
+         const double * changes,
+         int count,
+         std::size_t columnStride,
+         std::size_t barStride,
+         bool percent,
+         int * indicator,
+         double * inflections,
+         double * targets,
+         double * corrections,
+         int * age)
+{
+   std::vector<ZigZag> zz(count, ZigZag(percent));
+   for(int ii = 0; ii < len; ++ii) {
+      for(int kk = 0; kk < count; ++kk) {
+         std::size_t id = (std::size_t)kk*len + ii;
+         zz[kk].step(
+               close[ii], changes[kk*columnStride + ii*barStride],
+               indicator[id], inflections[id], targets[id], corrections[id], age[id]);
       }
    }
 }
@@ -402,7 +467,8 @@ void zigZag(
 // [[Rcpp::export("zig.zag.interface")]]
 Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent)
 {
-   std::vector<double> prices = Rcpp::as<std::vector<double> >(pricesIn);
+   // The prices are either a vector or a bar session (the close is used)
+   PricesArg prices(pricesIn);
    std::vector<double> changes = Rcpp::as<std::vector<double> >(changesIn);
    
    std::vector<int> indicator;
@@ -411,7 +477,7 @@ Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent)
    std::vector<double> targets;
    std::vector<int> age;
    
-   zigZag(prices, changes, percent, indicator, inflections, targets, corrections, age);
+   zigZag(prices.prices(), prices.size(), changes, percent, indicator, inflections, targets, corrections, age);
    
    return Rcpp::List::create(
                Rcpp::Named("indicator") = Rcpp::IntegerVector(indicator.begin(), indicator.end()),
@@ -419,4 +485,166 @@ Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent)
                Rcpp::Named("targets") = Rcpp::NumericVector(targets.begin(), targets.end()),
                Rcpp::Named("corrections") = Rcpp::NumericVector(corrections.begin(), corrections.end()),
                Rcpp::Named("age") = Rcpp::IntegerVector(age.begin(), age.end()));
+}
+
+// changes is either a matrix with a column of thresholds per zig-zag, or a vector
+// of constant thresholds, one per zig-zag.
+// [[Rcpp::export("zig.zag.multi.interface")]]
+Rcpp::List zigZagMultiInterface(SEXP pricesIn, SEXP changesIn, bool percent)
+{
+   // The prices are either a vector or a bar session (the close is used)
+   PricesArg prices(pricesIn);
+   Rcpp::NumericVector changes(changesIn);
+   int len = prices.size();
+
+   int count;
+   std::size_t columnStride, barStride;
+   if(Rf_isMatrix(changes)) {
+      if(Rf_nrows(changes) != len) Rcpp::stop("the changes must have a row per price");
+      count = Rf_ncols(changes);
+      columnStride = len;
+      barStride = 1;
+   } else {
+      count = changes.size();
+      columnStride = 1;
+      barStride = 0;
+   }
+
+   Rcpp::IntegerMatrix indicator(len, count);
+   Rcpp::NumericMatrix inflections(len, count);
+   Rcpp::NumericMatrix targets(len, count);
+   Rcpp::NumericMatrix corrections(len, count);
+   Rcpp::IntegerMatrix age(len, count);
+
+   zigZagMulti(
+         prices.prices(), len, changes.begin(), count, columnStride, barStride, percent,
+         indicator.begin(), inflections.begin(), targets.begin(), corrections.begin(), age.begin());
+
+   return Rcpp::List::create(
+               Rcpp::Named("indicator") = indicator,
+               Rcpp::Named("inflections") = inflections,
+               Rcpp::Named("targets") = targets,
+               Rcpp::Named("corrections") = corrections,
+               Rcpp::Named("age") = age);
+}
+
+// A zig-zag which is continued as new bars arrive
+// [[Rcpp::export("zig.zag.state.interface")]]
+SEXP zigZagStateInterface(bool percent)
+{
+   return wrapPointer(new ZigZag(percent), "zig-zag state");
+}
+
+// Feeds the new bars through the state, returns the outputs for them only
+// [[Rcpp::export("zig.zag.update.interface")]]
+Rcpp::List zigZagUpdateInterface(SEXP stateIn, SEXP pricesIn, SEXP changesIn)
+{
+   ZigZag * state = unwrapPointer<ZigZag>(stateIn, "zig-zag state");
+   Rcpp::NumericVector prices(pricesIn);
+   Rcpp::NumericVector changes(changesIn);
+
+   int len = prices.size();
+   if(changes.size() != len) Rcpp::stop("the changes must have the same length as the prices");
+
+   Rcpp::IntegerVector indicator(len);
+   Rcpp::NumericVector inflections(len);
+   Rcpp::NumericVector targets(len);
+   Rcpp::NumericVector corrections(len);
+   Rcpp::IntegerVector age(len);
+
+   for(int ii = 0; ii < len; ++ii) {
+      state->step(prices[ii], changes[ii], indicator[ii], inflections[ii], targets[ii], corrections[ii], age[ii]);
+   }
+
+   return Rcpp::List::create(
+               Rcpp::Named("indicator") = indicator,
+               Rcpp::Named("inflections") = inflections,
+               Rcpp::Named("targets") = targets,
+               Rcpp::Named("corrections") = corrections,
+               Rcpp::Named("age") = age);
+}
+
+// The bars before the first non-NA, stops on NAs after it like TTR's runMean
+int returnsLeadingNAs(const double * returns, int size)
+{
+   int first = 0;
+   while(first < size && ISNAN(returns[first])) ++first;
+   for(int ii = first; ii < size; ++ii) {
+      if(ISNAN(returns[ii])) Rcpp::stop("Series contains non-leading NAs");
+   }
+   return first;
+}
+
+// The RSI of the returns over a rolling window of n bars - 100 times the mean of
+// the gains over the sum of the means of the gains and the losses. The bars before
+// first (the leading NAs) and the first n - 1 bars after them are NAs. The window
+// sums are rolled the way runSum does it, thus, a bar costs the same for any n.
+void returnsRsi(const double * returns, int size, int first, int n, double * rsi)
+{
+   std::fill(rsi, rsi + size, NA_REAL);
+   if(n < 1 || first + n > size) return;
+
+   // The sums and the number of non-zero gains and losses in the window. Once a
+   // count drops to 0, the sum is reset - rolling leaves rounding residue behind.
+   double up = 0.0;
+   double dn = 0.0;
+   int ups = 0;
+   int dns = 0;
+   for(int ii = first; ii < first + n; ++ii) {
+      if(returns[ii] < 0) {
+         dn -= returns[ii];
+         ++dns;
+      } else if(returns[ii] > 0) {
+         up += returns[ii];
+         ++ups;
+      }
+   }
+
+   for(int ii = first + n - 1; ; ) {
+      double mavgUp = up / n;
+      double mavgDn = dn / n;
+      rsi[ii] = 100*mavgUp/(mavgUp + mavgDn);
+
+      if(++ii == size) break;
+
+      double in = returns[ii];
+      double out = returns[ii - n];
+      up = up + (in > 0 ? in : 0.0) - (out > 0 ? out : 0.0);
+      dn = dn + (in < 0 ? -in : 0.0) - (out < 0 ? -out : 0.0);
+      ups += (in > 0) - (out > 0);
+      dns += (in < 0) - (out < 0);
+      if(ups == 0) up = 0.0;
+      if(dns == 0) dn = 0.0;
+   }
+}
+
+// [[Rcpp::export("returns.rsi.interface")]]
+Rcpp::NumericVector returnsRsiInterface(SEXP returnsIn, int n)
+{
+   Rcpp::NumericVector returns(returnsIn);
+   int size = returns.size();
+   int first = returnsLeadingNAs(returns.begin(), size);
+
+   Rcpp::NumericVector res(size);
+   returnsRsi(returns.begin(), size, first, n, res.begin());
+   return res;
+}
+
+// A column per n, computed in parallel
+// [[Rcpp::export("returns.rsi.batch.interface")]]
+Rcpp::NumericMatrix returnsRsiBatchInterface(SEXP returnsIn, SEXP nsIn, int threads)
+{
+   Rcpp::NumericVector returns(returnsIn);
+   std::vector<int> ns = Rcpp::as< std::vector<int> >(nsIn);
+   int size = returns.size();
+   int first = returnsLeadingNAs(returns.begin(), size);
+
+   Rcpp::NumericMatrix res(size, (int)ns.size());
+   const double * in = returns.begin();
+   double * out = res.begin();
+   parallelFor(ns.size(), threads, [&, in, out](std::size_t cc, int) {
+      returnsRsi(in, size, first, ns[cc], out + cc*size);
+   });
+
+   return res;
 }
\ No newline at end of file
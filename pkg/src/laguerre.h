@@ -0,0 +1,92 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LAGUERRE_H_INCLUDED
+#define LAGUERRE_H_INCLUDED
+
+// The state of the four stage Laguerre filter (John Ehlers), one bar at a time.
+// Follows the batch computation, including the warm-up: stage k starts updating
+// at the k-th bar (0 based), before that it stays at 0.
+class LaguerreState {
+public:
+   explicit LaguerreState(double gamma) :
+      gamma_(gamma), bars_(0), l0_(0.0), l1_(0.0), l2_(0.0), l3_(0.0)
+   {}
+
+   void update(double price) {
+      step(price, gamma_, bars_, l0_, l1_, l2_, l3_);
+      ++bars_;
+   }
+
+   double filter() const { return filterValue(l0_, l1_, l2_, l3_); }
+   double rsi() const { return rsiValue(l0_, l1_, l2_, l3_); }
+
+   // One step of the filter stages, bar is the 0 based index of price
+   static void step(double price, double gamma, int bar, double & l0, double & l1, double & l2, double & l3) {
+      double n0 = l0, n1 = l1, n2 = l2, n3 = l3;
+      if(bar >= 1) n0 = (1.0 - gamma)*price + gamma*l0;
+      if(bar >= 2) n1 = -gamma*n0 + l0 + gamma*l1;
+      if(bar >= 3) n2 = -gamma*n1 + l1 + gamma*l2;
+      if(bar >= 4) n3 = -gamma*n2 + l2 + gamma*l3;
+      l0 = n0;
+      l1 = n1;
+      l2 = n2;
+      l3 = n3;
+   }
+
+   static double filterValue(double l0, double l1, double l2, double l3) {
+      return (l0 + 2.0*l1 + 2.0*l2 + l3) / 6.0;
+   }
+
+   static double rsiValue(double l0, double l1, double l2, double l3) {
+      double cu = 0.0;
+      double cd = 0.0;
+
+      if(l0 > l1) cu = l0 - l1;
+      else cd = l1 - l0;
+
+      if(l1 > l2) cu += l1 - l2;
+      else cd += l2 - l1;
+
+      if(l2 > l3) cu += l2 - l3;
+      else cd += l3 - l2;
+
+      return (cu + cd) > 0.0 ? cu / (cu + cd) : 0.0;
+   }
+
+   double gamma() const { return gamma_; }
+   int bars() const { return bars_; }
+
+private:
+   double gamma_;
+   int bars_;
+   double l0_;
+   double l1_;
+   double l2_;
+   double l3_;
+};
+
+#endif // LAGUERRE_H_INCLUDED
@@ -0,0 +1,77 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+
+using namespace Rcpp;
+
+// Splits the rows of a query ordered by symbol into the bars of each symbol.
+// lengths are the numbers of consecutive rows of each symbol (the run lengths of
+// the symbol column), times the row times and columnsIn the numeric columns of
+// the rows. Each symbol gets its times and a matrix of its columns, filled with
+// a copy per column instead of subsetting the query result for each symbol.
+// [[Rcpp::export("split.bars.interface")]]
+Rcpp::List splitBarsInterface(SEXP lengthsIn, SEXP timesIn, SEXP columnsIn)
+{
+   Rcpp::IntegerVector lengths(lengthsIn);
+   Rcpp::NumericVector times(timesIn);
+   Rcpp::List columnsList(columnsIn);
+
+   int rows = times.size();
+   int ncols = columnsList.size();
+   std::vector<const double *> columns(ncols);
+   std::vector<Rcpp::NumericVector> protect(ncols);   // Keeps the coerced columns alive
+   for(int cc = 0; cc < ncols; ++cc) {
+      Rcpp::NumericVector column = columnsList[cc];
+      if(column.size() != rows) Rcpp::stop("the columns must have a value per row");
+      protect[cc] = column;
+      columns[cc] = column.begin();
+   }
+
+   Rcpp::List res(lengths.size());
+   int beg = 0;
+   for(int ss = 0; ss < lengths.size(); ++ss) {
+      int len = lengths[ss];
+      if(len < 0 || beg + len > rows) Rcpp::stop("the lengths don't match the rows");
+
+      Rcpp::NumericMatrix bars(len, ncols);
+      for(int cc = 0; cc < ncols; ++cc) {
+         std::copy(columns[cc] + beg, columns[cc] + beg + len, bars.begin() + cc*len);
+      }
+
+      res[ss] = Rcpp::List::create(
+                     Rcpp::Named("times") = Rcpp::NumericVector(times.begin() + beg, times.begin() + beg + len),
+                     Rcpp::Named("bars") = bars);
+      beg += len;
+   }
+
+   if(beg != rows) Rcpp::stop("the lengths don't match the rows");
+   return res;
+}
@@ -0,0 +1,175 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <deque>
+#include <exception>
+
+// The worker threads must not call into R: no allocations, no Rcpp objects,
+// no R_CheckUserInterrupt. Convert the inputs before and the outputs after.
+
+// The first exception thrown by a worker. The other workers stop at their next
+// task and the exception is rethrown on the calling thread after the join - an
+// exception escaping a std::thread terminates the process, R session included.
+class WorkerError {
+public:
+   WorkerError() : failed_(false) {}
+
+   bool failed() const { return failed_; }
+
+   void set(std::exception_ptr error) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if(!error_) error_ = error;
+      failed_ = true;
+   }
+
+   void rethrow() {
+      if(error_) std::rethrow_exception(error_);
+   }
+
+private:
+   std::atomic<bool> failed_;
+   std::mutex mutex_;
+   std::exception_ptr error_;
+};
+
+// The number of threads to use. Non-positive values mean all cores.
+inline int threadCount(int threads, std::size_t tasks)
+{
+   if(threads <= 0) threads = std::thread::hardware_concurrency();
+   if(threads <= 0) threads = 1;
+   if(static_cast<std::size_t>(threads) > tasks) threads = tasks;
+   return std::max(threads, 1);
+}
+
+// Calls func(ii, worker) for each ii in [0, tasks). The tasks are handed out
+// one at a time through a shared counter, thus, uneven tasks are balanced.
+// worker is in [0, threads) and identifies the calling thread.
+template <typename Func>
+void parallelFor(std::size_t tasks, int threads, Func func)
+{
+   threads = threadCount(threads, tasks);
+   if(threads == 1) {
+      for(std::size_t ii = 0; ii < tasks; ++ii) func(ii, 0);
+      return;
+   }
+
+   std::atomic<std::size_t> next(0);
+   WorkerError error;
+   std::vector<std::thread> pool;
+   pool.reserve(threads);
+   for(int tt = 0; tt < threads; ++tt) {
+      pool.push_back(std::thread([&next, &func, &error, tasks, tt]() {
+         try {
+            for(std::size_t ii = next++; ii < tasks && !error.failed(); ii = next++) func(ii, tt);
+         } catch(...) {
+            error.set(std::current_exception());
+         }
+      }));
+   }
+
+   for(std::size_t tt = 0; tt < pool.size(); ++tt) pool[tt].join();
+   error.rethrow();
+}
+
+// Like parallelFor, for tasks of very different sizes - cost(ii) estimates the work
+// of task ii. The tasks are dealt upfront, the most expensive first, round robin into
+// a queue per worker. A worker takes from the front of its own queue and, once it
+// runs dry, steals from the back of the others. Thus, the expensive tasks start
+// early and the idle workers pick up the cheap leftovers of the busy ones.
+template <typename Cost, typename Func>
+void parallelForStealing(std::size_t tasks, int threads, Cost cost, Func func)
+{
+   std::vector<double> costs(tasks);
+   std::vector<std::size_t> order(tasks);
+   for(std::size_t ii = 0; ii < tasks; ++ii) {
+      costs[ii] = cost(ii);
+      order[ii] = ii;
+   }
+   std::stable_sort(order.begin(), order.end(), [&costs](std::size_t aa, std::size_t bb) {
+      return costs[aa] > costs[bb];
+   });
+
+   threads = threadCount(threads, tasks);
+   if(threads == 1) {
+      for(std::size_t kk = 0; kk < tasks; ++kk) func(order[kk], 0);
+      return;
+   }
+
+   struct TaskQueue {
+      std::mutex mutex;
+      std::deque<std::size_t> tasks;
+   };
+
+   std::vector<TaskQueue> queues(threads);
+   for(std::size_t kk = 0; kk < tasks; ++kk) queues[kk % threads].tasks.push_back(order[kk]);
+
+   // No tasks are added once the workers start - all queues empty means done
+   auto take = [&queues](int qq, bool front, std::size_t & ii) {
+      TaskQueue & queue = queues[qq];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if(queue.tasks.empty()) return false;
+      if(front) {
+         ii = queue.tasks.front();
+         queue.tasks.pop_front();
+      } else {
+         ii = queue.tasks.back();
+         queue.tasks.pop_back();
+      }
+      return true;
+   };
+
+   WorkerError error;
+   std::vector<std::thread> pool;
+   pool.reserve(threads);
+   for(int tt = 0; tt < threads; ++tt) {
+      pool.push_back(std::thread([&take, &func, &error, threads, tt]() {
+         try {
+            std::size_t ii;
+            while(!error.failed()) {
+               bool found = take(tt, true, ii);
+               for(int vv = 1; !found && vv < threads; ++vv) found = take((tt + vv) % threads, false, ii);
+               if(!found) break;
+               func(ii, tt);
+            }
+         } catch(...) {
+            error.set(std::current_exception());
+         }
+      }));
+   }
+
+   for(std::size_t tt = 0; tt < pool.size(); ++tt) pool[tt].join();
+   error.rethrow();
+}
+
+#endif // PARALLEL_H_INCLUDED
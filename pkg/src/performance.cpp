@@ -0,0 +1,96 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "common.h"
+#include "processTrades.h"
+#include "performance.h"
+
+using namespace Rcpp;
+
+// The names of the exit reasons, in the order of their values
+const char * const EXIT_REASON_NAMES[EXIT_REASONS] = {
+   "EXIT_ON_LAST",
+   "STOP_LIMIT_ON_OPEN",
+   "STOP_LIMIT_ON_HIGH",
+   "STOP_LIMIT_ON_LOW",
+   "STOP_LIMIT_ON_CLOSE",
+   "STOP_TRAILING_ON_OPEN",
+   "STOP_TRAILING_ON_HIGH",
+   "STOP_TRAILING_ON_LOW",
+   "STOP_TRAILING_ON_CLOSE",
+   "PROFIT_TARGET_ON_OPEN",
+   "PROFIT_TARGET_ON_HIGH",
+   "PROFIT_TARGET_ON_LOW",
+   "PROFIT_TARGET_ON_CLOSE",
+   "MAX_DAYS_LIMIT" };
+
+// The statistics as an R list, trades may be empty
+Rcpp::List performanceList(const ReturnStats & returns, const TradeStats & trades, double periods)
+{
+   return Rcpp::List::create(
+               Rcpp::Named("CAGR") = returns.cagr(periods),
+               Rcpp::Named("Volatility") = returns.volatility(periods),
+               Rcpp::Named("Sharpe") = returns.sharpe(periods),
+               Rcpp::Named("Sortino") = returns.sortino(periods),
+               Rcpp::Named("MaxDrawdown") = returns.maxDrawdown,
+               Rcpp::Named("MaxDrawdownBars") = returns.maxDrawdownBars,
+               Rcpp::Named("Trades") = trades.trades,
+               Rcpp::Named("WinRate") = trades.winRate(),
+               Rcpp::Named("ProfitFactor") = trades.profitFactor(),
+               Rcpp::Named("AvgMAE") = trades.averageMae(),
+               Rcpp::Named("AvgMFE") = trades.averageMfe(),
+               Rcpp::Named("Reasons") = Rcpp::IntegerVector(trades.reasons, trades.reasons + EXIT_REASONS));
+}
+
+// returns is the per-bar return series (calculate.returns), trades is either NULL
+// or the process.trades data frame - only the Gain, MAE, MFE and Reason columns are used.
+// [[Rcpp::export("performance.stats.interface")]]
+Rcpp::List performanceStatsInterface(SEXP returnsIn, SEXP tradesIn, double periods)
+{
+   Rcpp::NumericVector returns(returnsIn);
+
+   ReturnStats returnStats;
+   for(R_xlen_t ii = 0; ii < returns.size(); ++ii) {
+      returnStats.add(returns[ii]);
+   }
+
+   TradeStats tradeStats;
+   if(!Rf_isNull(tradesIn)) {
+      Rcpp::List trades(tradesIn);
+      Rcpp::NumericVector gain = trades["Gain"];
+      Rcpp::NumericVector mae = trades["MAE"];
+      Rcpp::NumericVector mfe = trades["MFE"];
+      Rcpp::IntegerVector reason = trades["Reason"];
+
+      for(R_xlen_t ii = 0; ii < gain.size(); ++ii) {
+         tradeStats.add(gain[ii], mae[ii], mfe[ii], reason[ii]);
+      }
+   }
+
+   return performanceList(returnStats, tradeStats, periods);
+}
@@ -0,0 +1,187 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PERFORMANCE_H_INCLUDED
+#define PERFORMANCE_H_INCLUDED
+
+#include <cmath>
+#include <algorithm>
+
+#include "common.h"
+#include "processTrades.h"
+
+// The names of the exit reasons, in the order of their values
+extern const char * const EXIT_REASON_NAMES[EXIT_REASONS];
+
+// Accumulates the statistics of a per-bar return series in a single pass. The
+// returns are simple (not log) returns, NAs are skipped. Doesn't touch the R API,
+// thus, it's safe to use from the worker threads.
+struct ReturnStats {
+   int bars;
+
+   // Running mean and sum of squared deviations (Welford)
+   double mean;
+   double m2;
+
+   // Sum of the squared negative returns, for the downside deviation
+   double downSq;
+
+   // The compounded equity curve, starting at 1
+   double equity;
+   double peak;
+
+   // The duration of a drawdown is the number of bars spent below the previous
+   // peak. maxDrawdownBars is the duration of the episode with the max drawdown,
+   // up to the recovery or to the last bar.
+   double maxDrawdown;
+   int drawdownBars;
+   int maxDrawdownBars;
+   bool inMaxDrawdown;
+
+   ReturnStats() :
+      bars(0), mean(0.0), m2(0.0), downSq(0.0), equity(1.0), peak(1.0),
+      maxDrawdown(0.0), drawdownBars(0), maxDrawdownBars(0), inMaxDrawdown(false)
+   {}
+
+   void add(double ret) {
+      if(std::isnan(ret)) return;
+
+      ++bars;
+      double delta = ret - mean;
+      mean += delta / bars;
+      m2 += delta*(ret - mean);
+
+      if(ret < 0.0) downSq += ret*ret;
+
+      equity *= 1.0 + ret;
+      if(equity >= peak) {
+         peak = equity;
+         drawdownBars = 0;
+         inMaxDrawdown = false;
+      } else {
+         ++drawdownBars;
+         double drawdown = 1.0 - equity / peak;
+         if(drawdown > maxDrawdown) {
+            maxDrawdown = drawdown;
+            inMaxDrawdown = true;
+         }
+         if(inMaxDrawdown) maxDrawdownBars = drawdownBars;
+      }
+   }
+
+   // The annualized compound growth rate
+   double cagr(double periods) const {
+      return bars > 0 ? std::pow(equity, periods / bars) - 1.0 : NA_REAL;
+   }
+
+   // The annualized standard deviation
+   double volatility(double periods) const {
+      return bars > 1 ? std::sqrt(m2 / (bars - 1))*std::sqrt(periods) : NA_REAL;
+   }
+
+   // The annualized Sharpe ratio, with a zero risk free rate
+   double sharpe(double periods) const {
+      double sd = bars > 1 ? std::sqrt(m2 / (bars - 1)) : 0.0;
+      return sd > 0.0 ? mean / sd*std::sqrt(periods) : NA_REAL;
+   }
+
+   // The annualized Sortino ratio, the downside deviation is against 0
+   double sortino(double periods) const {
+      double dd = bars > 0 ? std::sqrt(downSq / bars) : 0.0;
+      return dd > 0.0 ? mean / dd*std::sqrt(periods) : NA_REAL;
+   }
+};
+
+// Accumulates the statistics of a set of trades (the processTrades output)
+struct TradeStats {
+   int trades;
+   int wins;
+
+   double grossProfit;
+   double grossLoss;
+
+   double sumMae;
+   double sumMfe;
+
+   int reasons[EXIT_REASONS];
+
+   TradeStats() :
+      trades(0), wins(0), grossProfit(0.0), grossLoss(0.0), sumMae(0.0), sumMfe(0.0)
+   {
+      std::fill(reasons, reasons + EXIT_REASONS, 0);
+   }
+
+   void add(double gain, double mae, double mfe, int reason) {
+      ++trades;
+      if(gain > 0.0) {
+         ++wins;
+         grossProfit += gain;
+      } else if(gain < 0.0) {
+         grossLoss -= gain;
+      }
+
+      sumMae += mae;
+      sumMfe += mfe;
+
+      if(reason >= 0 && reason < EXIT_REASONS) ++reasons[reason];
+   }
+
+   double winRate() const { return trades > 0 ? double(wins) / trades : NA_REAL; }
+
+   // Infinite if there are no losing trades
+   double profitFactor() const {
+      if(grossLoss > 0.0) return grossProfit / grossLoss;
+      return grossProfit > 0.0 ? R_PosInf : NA_REAL;
+   }
+
+   double averageMae() const { return trades > 0 ? sumMae / trades : NA_REAL; }
+   double averageMfe() const { return trades > 0 ? sumMfe / trades : NA_REAL; }
+};
+
+// The summary of a set of trades, enough to rank a parameter set. The equity
+// compounds the trade gains in the order they were added, one step per trade,
+// thus, the drawdown and the Sharpe ratio are per trade.
+struct TradeSummary {
+   TradeStats trades;
+   ReturnStats equity;
+
+   void add(double gain, double mae, double mfe, int reason) {
+      trades.add(gain, mae, mfe, reason);
+      equity.add(gain);
+   }
+
+   double totalGain() const { return trades.grossProfit - trades.grossLoss; }
+   double sharpe() const { return equity.sharpe(1.0); }
+
+   // The compounded return over the max drawdown, infinite without a drawdown
+   double drawdownAdjusted() const {
+      double ret = equity.equity - 1.0;
+      if(equity.maxDrawdown > 0.0) return ret / equity.maxDrawdown;
+      return ret > 0.0 ? R_PosInf : ret;
+   }
+};
+
+#endif // PERFORMANCE_H_INCLUDED
@@ -29,24 +29,13 @@
 #include <cassert>
 
 #include "common.h"
+#include "processTrades.h"
+#include "rangeIndex.h"
+#include "session.h"
+#include "runs.h"
 
 using namespace Rcpp;
 
-#define EXIT_ON_LAST             0
-#define STOP_LIMIT_ON_OPEN       1
-#define STOP_LIMIT_ON_HIGH       2
-#define STOP_LIMIT_ON_LOW        3
-#define STOP_LIMIT_ON_CLOSE      4
-#define STOP_TRAILING_ON_OPEN    5
-#define STOP_TRAILING_ON_HIGH    6
-#define STOP_TRAILING_ON_LOW     7
-#define STOP_TRAILING_ON_CLOSE   8
-#define PROFIT_TARGET_ON_OPEN    9
-#define PROFIT_TARGET_ON_HIGH   10
-#define PROFIT_TARGET_ON_LOW    11
-#define PROFIT_TARGET_ON_CLOSE  12
-#define MAX_DAYS_LIMIT          13
-
 // #define DEBUG
 
 #ifdef DEBUG
@@ -94,7 +83,109 @@ struct TradeLocals {
    {}
 };
 
-inline bool processShort(
+// The stop order of a trade. A trailing stop takes precedence over a stop loss.
+enum StopKind { NO_STOP, FIXED_STOP, TRAILING_STOP };
+
+// The direction specific pieces of the bar kernel, Dir is 1 for long and -1 for short.
+// The adverse side of a bar is the low for longs and the high for shorts.
+template <int Dir> struct Direction;
+
+template <> struct Direction<1> {
+   static bool reachesStop(double price, double stopPrice) { return price <= stopPrice; }
+   static bool reachesTarget(double price, double targetPrice) { return price >= targetPrice; }
+
+   static double adverse(double /*hi*/, double lo) { return lo; }
+   static double favorable(double hi, double /*lo*/) { return hi; }
+
+   static double stopLevel(double price, double pct, double tickSize) { return roundAny(price*(1.0 - std::abs(pct)), tickSize); }
+   static double targetLevel(double price, double pct, double tickSize) { return roundAny(price*(1.0 + std::abs(pct)), tickSize); }
+
+   // Whether the open/favorable side makes a new extreme for the trailing stop
+   static bool extendsAtOpen(double op, const TradeLocals & locals) { return op > locals.maxPrice; }
+   static bool extends(double price, const TradeLocals & locals) { return price > locals.maxPrice; }
+
+   static void trail(double price, TradeLocals & locals) {
+      locals.maxPrice = price;
+      locals.stopPrice = stopLevel(locals.maxPrice, locals.stopTrailing, locals.tickSize);
+   }
+
+   // Updates the min and max price with the prices seen on each side
+   static void touch(TradeLocals & locals, double adverse, double favorable) {
+      locals.minPrice = std::min(adverse, locals.minPrice);
+      locals.maxPrice = std::max(favorable, locals.maxPrice);
+   }
+
+   // A trailing stop hit inside the bar - the adverse side is assumed to come first
+   static void touchTrailingStop(TradeLocals & locals) {
+      locals.minPrice = std::min(locals.minPrice, locals.stopPrice);
+   }
+
+   static int findStop(const RangeIndex & index, int from, int to, double level) { return index.findLowAtOrBelow(from, to, level); }
+   static int findTarget(const RangeIndex & index, int from, int to, double level) { return index.findHighAtOrAbove(from, to, level); }
+
+   static const int STOP_TRAILING_INSIDE = STOP_TRAILING_ON_LOW;
+   static const int STOP_LIMIT_INSIDE = STOP_LIMIT_ON_LOW;
+   static const int PROFIT_TARGET_INSIDE = PROFIT_TARGET_ON_HIGH;
+
+   // Longs check only the trailing stop at the close, shorts check all orders
+   static const bool FIXED_ORDERS_ON_CLOSE = false;
+
+   static void results(const TradeLocals & locals, double exitPrice, double & gain, double & mae, double & mfe) {
+      gain = exitPrice / locals.entryPrice - 1.0;
+
+      mae = locals.minPrice / locals.entryPrice - 1.0;
+      mfe = locals.maxPrice / locals.entryPrice - 1.0;
+   }
+};
+
+template <> struct Direction<-1> {
+   static bool reachesStop(double price, double stopPrice) { return price >= stopPrice; }
+   static bool reachesTarget(double price, double targetPrice) { return price <= targetPrice; }
+
+   static double adverse(double hi, double /*lo*/) { return hi; }
+   static double favorable(double /*hi*/, double lo) { return lo; }
+
+   static double stopLevel(double price, double pct, double tickSize) { return roundAny(price*(1.0 + std::abs(pct)), tickSize); }
+   static double targetLevel(double price, double pct, double tickSize) { return roundAny(price*(1.0 - std::abs(pct)), tickSize); }
+
+   static bool extendsAtOpen(double op, const TradeLocals & locals) { return op <= locals.minPrice; }
+   static bool extends(double price, const TradeLocals & locals) { return price < locals.minPrice; }
+
+   static void trail(double price, TradeLocals & locals) {
+      locals.minPrice = price;
+      locals.stopPrice = stopLevel(locals.minPrice, locals.stopTrailing, locals.tickSize);
+   }
+
+   static void touch(TradeLocals & locals, double adverse, double favorable) {
+      locals.minPrice = std::min(favorable, locals.minPrice);
+      locals.maxPrice = std::max(adverse, locals.maxPrice);
+   }
+
+   static void touchTrailingStop(TradeLocals & locals) {
+      locals.maxPrice = std::max(locals.maxPrice, locals.stopPrice);
+   }
+
+   static int findStop(const RangeIndex & index, int from, int to, double level) { return index.findHighAtOrAbove(from, to, level); }
+   static int findTarget(const RangeIndex & index, int from, int to, double level) { return index.findLowAtOrBelow(from, to, level); }
+
+   static const int STOP_TRAILING_INSIDE = STOP_TRAILING_ON_HIGH;
+   static const int STOP_LIMIT_INSIDE = STOP_LIMIT_ON_HIGH;
+   static const int PROFIT_TARGET_INSIDE = PROFIT_TARGET_ON_LOW;
+
+   static const bool FIXED_ORDERS_ON_CLOSE = true;
+
+   static void results(const TradeLocals & locals, double exitPrice, double & gain, double & mae, double & mfe) {
+      gain = 1.0 - exitPrice / locals.entryPrice;
+
+      mae = 1.0 - locals.maxPrice / locals.entryPrice;
+      mfe = 1.0 - locals.minPrice / locals.entryPrice;
+   }
+};
+
+// Processes a single bar. The order configuration is known at compile time,
+// thus, the branches on it are gone from the instantiations.
+template <int Dir, int Stop, bool Target>
+inline bool processBar(
    double op,
    double hi,
    double lo,
@@ -103,260 +194,210 @@ inline bool processShort(
    double & exitPrice,
    int & exitReason) {
 
+   typedef Direction<Dir> D;
+
    // Process the Open first
-   if(locals.hasStopTrailing) {
-      if(op >= locals.stopPrice) {
-         exitPrice = op;
-         exitReason = STOP_TRAILING_ON_OPEN;
-   
-         // Update min and max price
-         locals.minPrice = std::min(op, locals.minPrice);
-         locals.maxPrice = std::max(op, locals.maxPrice);
+   if(Stop != NO_STOP && D::reachesStop(op, locals.stopPrice)) {
+      exitPrice = op;
+      exitReason = Stop == TRAILING_STOP ? STOP_TRAILING_ON_OPEN : STOP_LIMIT_ON_OPEN;
 
-         return true;
-      } 
-   } else if(locals.hasStopLoss) {
-      if(op >= locals.stopPrice) {
-         exitPrice = op;
-         exitReason = STOP_LIMIT_ON_OPEN;
-         
-         // Update min and max price
-         locals.minPrice = std::min(op, locals.minPrice);
-         locals.maxPrice = std::max(op, locals.maxPrice);
+      // Update min and max price
+      D::touch(locals, op, op);
 
-         return true;
-      }
+      return true;
    }
-   
+
    // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
-      if(op <= locals.targetPrice) {
-         exitPrice = op;
-         exitReason = PROFIT_TARGET_ON_OPEN;
-                                    
-         // Update min and max price
-         locals.minPrice = std::min(op, locals.minPrice);
-         locals.maxPrice = std::max(op, locals.maxPrice);
+   if(Target && D::reachesTarget(op, locals.targetPrice)) {
+      exitPrice = op;
+      exitReason = PROFIT_TARGET_ON_OPEN;
 
-         return true;
-      }
-   }
-   
-   // The position is still on, update a trailing stop with the open
-   if(locals.hasStopTrailing && op <= locals.minPrice) {
-      locals.minPrice = op;
-      locals.stopPrice =
-         roundAny(locals.minPrice*(1.0 + std::abs(locals.stopTrailing)), locals.tickSize);
+      // Update min and max price
+      D::touch(locals, op, op);
+
+      return true;
    }
 
+   // The position is still on, update a trailing stop with the Open
+   if(Stop == TRAILING_STOP && D::extendsAtOpen(op, locals)) D::trail(op, locals);
+
    // Process the "internal" part of the bar
-   if(locals.hasStopTrailing) {
-      // Check the high
-      if(hi >= locals.stopPrice) {
-         exitPrice = locals.stopPrice;
-         exitReason = STOP_TRAILING_ON_HIGH;
-         
-         // Update max price. We are making the assumption that the high happened
-         // before the low. Thus, we don't want to update the min price.
-         locals.maxPrice = std::max(locals.maxPrice, locals.stopPrice);
-         
-         return true;
-      }
-   } else if(locals.hasStopLoss) {
-      if(hi >= locals.stopPrice) {
-         exitPrice = locals.stopPrice;
-         exitReason = STOP_LIMIT_ON_HIGH;
+   if(Stop != NO_STOP && D::reachesStop(D::adverse(hi, lo), locals.stopPrice)) {
+      exitPrice = locals.stopPrice;
+      if(Stop == TRAILING_STOP) {
+         exitReason = D::STOP_TRAILING_INSIDE;
+
+         // We are making the assumption that the adverse side happened first.
+         // Thus, we don't want to update the favorable side.
+         D::touchTrailingStop(locals);
+      } else {
+         exitReason = D::STOP_LIMIT_INSIDE;
 
          // Update min and max price
-         locals.minPrice = std::min(lo, locals.minPrice);
-         locals.maxPrice = std::max(locals.stopPrice, locals.maxPrice);
-         
-         return true;
+         D::touch(locals, locals.stopPrice, D::favorable(hi, lo));
       }
+
+      return true;
    }
-   
+
    // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
-      if(lo <= locals.targetPrice) {
-         exitPrice = locals.targetPrice;
-         exitReason = PROFIT_TARGET_ON_LOW;
-                                    
-         // Update min and max price
-         locals.minPrice = std::min(locals.targetPrice, locals.minPrice);
-         locals.maxPrice = std::max(hi, locals.maxPrice);
+   if(Target && D::reachesTarget(D::favorable(hi, lo), locals.targetPrice)) {
+      exitPrice = locals.targetPrice;
+      exitReason = D::PROFIT_TARGET_INSIDE;
 
-         return true;
-      }
-   }
-   
-   // The position is still on, update a trailing stop with the low
-   if(locals.hasStopTrailing && lo < locals.minPrice) {
-      locals.minPrice = lo;
-      locals.stopPrice =
-         roundAny(locals.minPrice*(1.0 + std::abs(locals.stopTrailing)), locals.tickSize);
+      // Update min and max price
+      D::touch(locals, D::adverse(hi, lo), locals.targetPrice);
+
+      return true;
    }
-   
+
+   // The position is still on, update a trailing stop with the favorable side
+   if(Stop == TRAILING_STOP && D::extends(D::favorable(hi, lo), locals)) D::trail(D::favorable(hi, lo), locals);
+
    // We have seen the Hi/Low - update min/maxPrice
    locals.minPrice = std::min(lo, locals.minPrice);
    locals.maxPrice = std::max(hi, locals.maxPrice);
-   
-   // Finally process the Close
-   if(locals.hasStopTrailing) {
-      if(cl >= locals.stopPrice) {
-         exitPrice = cl;
-         exitReason = STOP_TRAILING_ON_CLOSE;
-   
-         return true;
-      } 
-   } else if(locals.hasStopLoss) {
-      if(cl >= locals.stopPrice) {
-         exitPrice = cl;
-         exitReason = STOP_LIMIT_ON_CLOSE;
 
-         return true;
-      }
+   // Finally process the Close. The stop trailing might have been updated by
+   // the favorable side, thus, we need one more check at the Close.
+   if((Stop == TRAILING_STOP || (Stop == FIXED_STOP && D::FIXED_ORDERS_ON_CLOSE)) && D::reachesStop(cl, locals.stopPrice)) {
+      exitPrice = cl;
+      exitReason = Stop == TRAILING_STOP ? STOP_TRAILING_ON_CLOSE : STOP_LIMIT_ON_CLOSE;
+
+      return true;
    }
-   
-   // Finally process the Close for a stop trailing order. The stop trailing might
-   // have been updated by the Low, thus, we need one more check at the Close.
-   if(locals.hasProfitTarget) {
-      if(cl <= locals.targetPrice) {
-         exitPrice = cl;
-         exitReason = PROFIT_TARGET_ON_CLOSE;
-
-         return true;
-      }
+
+   if(Target && D::FIXED_ORDERS_ON_CLOSE && D::reachesTarget(cl, locals.targetPrice)) {
+      exitPrice = cl;
+      exitReason = PROFIT_TARGET_ON_CLOSE;
+
+      return true;
    }
-   
+
    return false;
 }
 
-inline bool processLong(
-   double op,
-   double hi,
-   double lo,
-   double cl,
+// Trades shorter than this are scanned bar by bar even with an index
+#define MIN_SKIP_BARS 64
+
+// For a trade with fixed orders (no trailing stop), finds the first bar in
+// [from, to] at which the stop loss or the profit target can be hit. The bars
+// before it are folded into the min and max prices. Returns to + 1 if there is
+// no such bar. Exact as long as the bars are regular (see RangeIndex).
+template <int Dir, int Stop, bool Target>
+inline int skipBars(
+   const RangeIndex & index,
+   int from,
+   int to,
+   TradeLocals & locals) {
+
+   typedef Direction<Dir> D;
+
+   if(to - from < MIN_SKIP_BARS || !index.isRegular(from, to)) return from;
+
+   int hit = to + 1;
+   int id;
+   if(Stop == FIXED_STOP && (id = D::findStop(index, from, to, locals.stopPrice)) >= 0) hit = id;
+   if(Target && (id = D::findTarget(index, from, hit - 1, locals.targetPrice)) >= 0) hit = id;
+
+   if(hit > from) {
+      locals.minPrice = std::min(index.minLow(from, hit - 1), locals.minPrice);
+      locals.maxPrice = std::max(index.maxHigh(from, hit - 1), locals.maxPrice);
+   }
+
+   return hit;
+}
+
+// Runs the bars of a trade through the kernel for its order configuration.
+// Returns the exit index.
+template <int Dir, int Stop, bool Target>
+int tradeBars(
+   const Ohlc & ohlc,
+   int ibeg,
+   int iend,
+   int maxDays,
+   const RangeIndex * index,
    TradeLocals & locals,
    double & exitPrice,
    int & exitReason) {
 
-   // Process the Open first
-   if(locals.hasStopTrailing) {
-      if(op <= locals.stopPrice) {
-         exitPrice = op;
-         exitReason = STOP_TRAILING_ON_OPEN;
-   
-         // Update min and max price
-         locals.minPrice = std::min(op, locals.minPrice);
-         locals.maxPrice = std::max(op, locals.maxPrice);
-
-         return true;
-      } 
-   } else if(locals.hasStopLoss) {
-      if(op <= locals.stopPrice) {
-         exitPrice = op;
-         exitReason = STOP_LIMIT_ON_OPEN;
-         
-         // Update min and max price
-         locals.minPrice = std::min(op, locals.minPrice);
-         locals.maxPrice = std::max(op, locals.maxPrice);
+   // The maximum days limit, if any, ends the trade before its last bar
+   bool maxDaysExit = maxDays > 0 && ibeg + maxDays <= iend;
+   int last = maxDaysExit ? ibeg + maxDays : iend;
 
-         return true;
-      }
+   int ii = ibeg + 1;
+   if(Stop != TRAILING_STOP && index != NULL) {
+      // The last bar is processed as usual
+      ii = skipBars<Dir, Stop, Target>(*index, ii, last - 1, locals);
    }
-   
-   // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
-      if(op >= locals.targetPrice) {
-         exitPrice = op;
-         exitReason = PROFIT_TARGET_ON_OPEN;
-                                    
-         // Update min and max price
-         locals.minPrice = std::min(op, locals.minPrice);
-         locals.maxPrice = std::max(op, locals.maxPrice);
 
-         return true;
-      }
-   }
-   
-   // The position is still on, update a trailing stop with the Open
-   if(locals.hasStopTrailing && op > locals.maxPrice) {
-      locals.maxPrice = op;
-      locals.stopPrice =
-         roundAny(locals.maxPrice*(1.0 - std::abs(locals.stopTrailing)), locals.tickSize);
+   for(; ii <= last; ++ii) {
+      if(processBar<Dir, Stop, Target>(ohlc.op[ii], ohlc.hi[ii], ohlc.lo[ii], ohlc.cl[ii], locals, exitPrice, exitReason)) return ii;
    }
 
-   // Process the "internal" part of the bar
-   if(locals.hasStopTrailing) {
-      // Check the high
-      if(lo <= locals.stopPrice) {
-         exitPrice = locals.stopPrice;
-         exitReason = STOP_TRAILING_ON_LOW;
-         
-         // Update min price. We are making the assumption that the low happened
-         // before the high. Thus, we don't want to update the max price.
-         locals.minPrice = std::min(locals.minPrice, locals.stopPrice);
-         
-         return true;
-      }
-   } else if(locals.hasStopLoss) {
-      if(lo <= locals.stopPrice) {
-         exitPrice = locals.stopPrice;
-         exitReason = STOP_LIMIT_ON_LOW;
+   // No order was hit
+   exitPrice = ohlc.cl[last];
+   exitReason = maxDaysExit ? MAX_DAYS_LIMIT : EXIT_ON_LAST;
 
-         // Update min and max price
-         locals.minPrice = std::min(locals.stopPrice, locals.minPrice);
-         locals.maxPrice = std::max(hi, locals.maxPrice);
-         
-         return true;
-      }
-   }
-   
-   // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
-      if(hi >= locals.targetPrice) {
-         exitPrice = locals.targetPrice;
-         exitReason = PROFIT_TARGET_ON_HIGH;
-                                    
-         // Update min and max price
-         locals.minPrice = std::min(lo, locals.minPrice);
-         locals.maxPrice = std::max(locals.targetPrice, locals.maxPrice);
+   return last;
+}
 
-         return true;
-      }
+// Sets the orders, picks the kernel (once per trade) and computes the results
+template <int Dir>
+int runTrade(
+   const Ohlc & ohlc,
+   int ibeg,
+   int iend,
+   double stopLoss,
+   double stopTrailing,
+   double profitTarget,
+   int maxDays,
+   const RangeIndex * index,
+   TradeLocals & locals,
+   double & exitPrice,
+   int & exitReason,
+   double & gain,
+   double & mae,
+   double & mfe) {
+
+   typedef Direction<Dir> D;
+
+   if(!isNA(stopTrailing)) {
+      locals.hasStopTrailing = true;
+      locals.stopTrailing = stopTrailing;
+      locals.stopPrice = D::stopLevel(locals.entryPrice, stopTrailing, locals.tickSize);
+   } else if(!isNA(stopLoss)) {
+      locals.hasStopLoss = true;
+      locals.stopLoss = stopLoss;
+      locals.stopPrice = D::stopLevel(locals.entryPrice, stopLoss, locals.tickSize);
    }
-   
-   // The position is still on, update a trailing stop with the High
-   if(locals.hasStopTrailing && hi > locals.maxPrice) {
-      locals.maxPrice = hi;
-      locals.stopPrice =
-         roundAny(locals.maxPrice*(1.0 - std::abs(locals.stopTrailing)), locals.tickSize);
+
+   if(!isNA(profitTarget)) {
+      locals.hasProfitTarget = true;
+      locals.profitTarget = profitTarget;
+      locals.targetPrice = D::targetLevel(locals.entryPrice, profitTarget, locals.tickSize);
    }
-   
-   // We have seen the Hi/Low - update min/maxPrice
-   locals.minPrice = std::min(lo, locals.minPrice);
-   locals.maxPrice = std::max(hi, locals.maxPrice);
-   
-   // Finally process the Close for a stop trailing order. The stop trailing might
-   // have been updated by the High, thus, we need one more check at the Close.
+
+   int ii;
    if(locals.hasStopTrailing) {
-      if(cl <= locals.stopPrice) {
-         exitPrice = cl;
-         exitReason = STOP_TRAILING_ON_CLOSE;
-   
-         return true;
-      } 
+      if(locals.hasProfitTarget) ii = tradeBars<Dir, TRAILING_STOP, true>(ohlc, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+      else ii = tradeBars<Dir, TRAILING_STOP, false>(ohlc, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+   } else if(locals.hasStopLoss) {
+      if(locals.hasProfitTarget) ii = tradeBars<Dir, FIXED_STOP, true>(ohlc, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+      else ii = tradeBars<Dir, FIXED_STOP, false>(ohlc, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+   } else {
+      if(locals.hasProfitTarget) ii = tradeBars<Dir, NO_STOP, true>(ohlc, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+      else ii = tradeBars<Dir, NO_STOP, false>(ohlc, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
    }
 
-   return false;
+   D::results(locals, exitPrice, gain, mae, mfe);
+
+   return ii;
 }
 
 // The actual workhorse used by the interface functions
 void processTrade(
-         const std::vector<double> & op,
-         const std::vector<double> & hi,
-         const std::vector<double> & lo,
-         const std::vector<double> & cl,
+         const Ohlc & ohlc,
          int ibeg,
          int iend,
          int pos,
@@ -372,110 +413,27 @@ void processTrade(
          double & minPrice,
          double & maxPrice,
          double & mae,  // maximum adverse excursion
-         double & mfe)  // maximum favorable excursion
+         double & mfe,  // maximum favorable excursion
+         const RangeIndex * index)
 {
-   int ii;
-   
    TradeLocals locals;
-   locals.hasStopLoss = false;
-   locals.hasStopTrailing = false;
-   locals.hasProfitTarget = false;
    locals.tickSize = tickSize;
 
    // Currently positions are initiated only at the close
-   locals.minPrice = locals.maxPrice = locals.entryPrice = cl[ibeg];
+   locals.minPrice = locals.maxPrice = locals.entryPrice = ohlc.cl[ibeg];
    
    if(pos < 0) {
-      // Short position
-      if(!isNA(stopTrailing)) {
-         locals.hasStopTrailing = true;
-         locals.stopTrailing = stopTrailing;
-         locals.stopPrice = roundAny(locals.entryPrice*(1.0 + std::abs(stopTrailing)), tickSize);
-      } else if(!isNA(stopLoss)) {
-         locals.hasStopLoss = true;
-         locals.stopLoss = stopLoss;
-         locals.stopPrice = roundAny(locals.entryPrice*(1.0 + std::abs(stopLoss)), tickSize);
-      }
-
-      if(!isNA(profitTarget)) {
-         locals.targetPrice = roundAny(locals.entryPrice*(1.0 - std::abs(profitTarget)), tickSize);
-         locals.profitTarget = profitTarget;
-         locals.hasProfitTarget = true;
-      }
-      
-      for(ii = ibeg + 1; ii <= iend; ++ii) {
-         if(processShort(op[ii], hi[ii], lo[ii], cl[ii], locals, exitPrice, exitReason)) break;
-
-         // Maximum days for the trade reached
-         if(maxDays > 0 && (ii - ibeg) == maxDays) {
-            exitPrice = cl[ii];
-            exitReason = MAX_DAYS_LIMIT;
-            
-            break;
-         }
-      }
-      
-      if(ii > iend) {
-         exitPrice = cl[iend];
-         exitReason = EXIT_ON_LAST;
-         
-         ii = iend;
-      }
-
-      gain = 1.0 - exitPrice / locals.entryPrice;
-
-      mae = 1.0 - locals.maxPrice / locals.entryPrice;
-      mfe = 1.0 - locals.minPrice / locals.entryPrice;
-      
-      minPrice = locals.minPrice;
-      maxPrice = locals.maxPrice;
+      exitIndex = runTrade<-1>(
+                     ohlc, ibeg, iend, stopLoss, stopTrailing, profitTarget, maxDays, index,
+                     locals, exitPrice, exitReason, gain, mae, mfe);
    } else {
-      // Long position
-      if(!isNA(stopTrailing)) {
-         locals.hasStopTrailing = true;
-         locals.stopTrailing = stopTrailing;
-         locals.stopPrice = roundAny(locals.entryPrice*(1.0 - std::abs(stopTrailing)), tickSize);
-      } else if(!isNA(stopLoss)) {
-         locals.hasStopLoss = true;
-         locals.stopLoss = stopLoss;
-         locals.stopPrice = roundAny(locals.entryPrice*(1.0 - std::abs(stopLoss)), tickSize);
-      }
-
-      if(!isNA(profitTarget)) {
-         locals.hasProfitTarget = true;
-         locals.profitTarget = profitTarget;
-         locals.targetPrice = roundAny(locals.entryPrice*(1.0 + std::abs(profitTarget)), tickSize);
-      }
-      
-      for(ii = ibeg + 1; ii <= iend; ++ii) {
-         if(processLong(op[ii], hi[ii], lo[ii], cl[ii], locals, exitPrice, exitReason)) break;
-
-         // Maximum days for the trade reached
-         if(maxDays > 0 && (ii - ibeg) == maxDays) {
-            exitPrice = cl[ii];
-            exitReason = MAX_DAYS_LIMIT;
-            
-            break;
-         }
-      }
-
-      if(ii > iend) {
-         exitPrice = cl[iend];
-         exitReason = EXIT_ON_LAST;
-         
-         ii = iend;
-      }
-
-      gain = exitPrice / locals.entryPrice - 1.0;
-
-      mae = locals.minPrice / locals.entryPrice - 1.0;
-      mfe = locals.maxPrice / locals.entryPrice - 1.0;
-      
-      minPrice = locals.minPrice;
-      maxPrice = locals.maxPrice;
+      exitIndex = runTrade<1>(
+                     ohlc, ibeg, iend, stopLoss, stopTrailing, profitTarget, maxDays, index,
+                     locals, exitPrice, exitReason, gain, mae, mfe);
    }
 
-   exitIndex = ii;
+   minPrice = locals.minPrice;
+   maxPrice = locals.maxPrice;
 }
 
 // [[Rcpp::export("process.trade.interface")]]
@@ -493,10 +451,34 @@ Rcpp::List processTradeInterface(
                int maxDays,
                double tickSize)
 {
-   std::vector<double> op = Rcpp::as< std::vector<double> >(opIn);
-   std::vector<double> hi = Rcpp::as< std::vector<double> >(hiIn);
-   std::vector<double> lo = Rcpp::as< std::vector<double> >(loIn);
-   std::vector<double> cl = Rcpp::as< std::vector<double> >(clIn);
+   Ohlc ohlc;
+   Rcpp::NumericVector op, hi, lo, cl;
+
+   // opIn is either a bar session (hiIn, loIn and clIn are ignored), or the open
+   BarSession * session = barSession(opIn);
+   if(session != NULL) {
+      ohlc = session->ohlc();
+   } else {
+      // Borrow the R vectors, no copies
+      op = Rcpp::NumericVector(opIn);
+      hi = Rcpp::NumericVector(hiIn);
+      lo = Rcpp::NumericVector(loIn);
+      cl = Rcpp::NumericVector(clIn);
+
+      if(hi.size() != op.size() || lo.size() != op.size() || cl.size() != op.size()) {
+         Rcpp::stop("op, hi, lo and cl must have the same length");
+      }
+
+      ohlc.op = op.begin();
+      ohlc.hi = hi.begin();
+      ohlc.lo = lo.begin();
+      ohlc.cl = cl.begin();
+      ohlc.size = op.size();
+   }
+
+   if(ibeg == NA_INTEGER || iend == NA_INTEGER || ibeg < 1 || ibeg > iend || iend > ohlc.size) {
+      Rcpp::stop("the trade must be within the bars, entry before exit");
+   }
 
    double exitPrice, minPrice, maxPrice;
    double gain, mae, mfe;
@@ -505,7 +487,7 @@ Rcpp::List processTradeInterface(
    
    // Call the actuall function to do the work. ibeg and iend are 0 based in cpp and 1 based in R.
    processTrade(
-      op, hi, lo, cl,
+      ohlc,
       ibeg-1, iend-1, pos, stopLoss, stopTrailing, profitTarget, maxDays, tickSize,
       exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe);
    
@@ -522,10 +504,7 @@ Rcpp::List processTradeInterface(
 }
 
 void processTrades(
-         const std::vector<double> & op,
-         const std::vector<double> & hi,
-         const std::vector<double> & lo,
-         const std::vector<double> & cl,
+         const Ohlc & ohlc,
          const std::vector<int> & ibeg,
          const std::vector<int> & iend,
          const std::vector<int> & position,
@@ -541,7 +520,8 @@ void processTrades(
          std::vector<double> & maxPriceOut,
          std::vector<double> & maeOut,
          std::vector<double> & mfeOut,
-         std::vector<int> & exitReasonOut )
+         std::vector<int> & exitReasonOut,
+         const RangeIndex * index )
 {
    DEBUG_MSG("processTrades: entered");
 
@@ -580,9 +560,9 @@ void processTrades(
       int exitReason;
 
       processTrade(
-            op, hi, lo, cl,
+            ohlc,
             ibeg[ii], iend[ii], position[ii], stopLoss[ii], stopTrailing[ii], profitTarget[ii], maxDays[ii], tickSize,
-            exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe);
+            exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe, index);
       // snprintf(buf, sizeof(buf), "%d: exitIndex = %d, exitPrice = %f, exitReason = %d, gain = %f, mae = %f, mfe = %f", 
       //         ii, exitIndex, exitPrice, exitReason, gain, mae, mfe);
       // DEBUG_MSG(buf);
@@ -620,39 +600,27 @@ Rcpp::List processTradesInterface(
    std::vector<double> profitTarget = Rcpp::as< std::vector<double> >( profitTargetIn );
    std::vector<int> maxDays  = Rcpp::as< std::vector<int> >( maxDaysIn );
 
-   // Convert ohlc into std vectors
-   Rcpp::NumericMatrix ohlcMatrix(ohlcIn);
-   std::vector<double> op;
-   std::vector<double> hi;
-   std::vector<double> lo;
-   std::vector<double> cl;
-   
-   int rows = ohlcMatrix.nrow();
+   // Borrow the ohlc columns straight from the R matrix, or from a bar session
+   OhlcArg ohlcArg(ohlcIn);
+   const Ohlc & ohlc = ohlcArg.ohlc();
    
-   op.reserve(rows);
-   hi.reserve(rows);
-   lo.reserve(rows);
-   cl.reserve(rows);
-   
-   for(int ii = 0; ii < rows; ++ii)
-   {
-      op.push_back(ohlcMatrix(ii, 0));
-      hi.push_back(ohlcMatrix(ii, 1));
-      lo.push_back(ohlcMatrix(ii, 2));
-      cl.push_back(ohlcMatrix(ii, 3));
-
+   std::vector<int>::size_type trades = ibeg.size();
+   if(iend.size() != trades || position.size() != trades || stopLoss.size() != trades ||
+         stopTrailing.size() != trades || profitTarget.size() != trades || maxDays.size() != trades) {
+      Rcpp::stop("the trade vectors must have the same length");
    }
-   
-   assert(false);
-   assert(ibeg.size() == iend.size());
 
    // vectors in c++ are zero based and in R are one based. convert
    // to the c++ format before calling the workhorse function.
+   tradesToZeroBased(ibeg, iend, ohlc.size);
+
+   // Only the trades without a trailing stop benefit from the range index
+   double bars = 0;
    for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
    {
-      ibeg[ii] -= 1;
-      iend[ii] -= 1;
+      if(isNA(stopTrailing[ii])) bars += iend[ii] - ibeg[ii];
    }
+   const RangeIndex * index = ohlcArg.rangeIndex(bars);
 
    // Allocate the output vectors
    std::vector<int> iendOut;
@@ -666,9 +634,9 @@ Rcpp::List processTradesInterface(
 
    // Call the c++ function doing the actual work
    processTrades(
-         op, hi, lo, cl,
+         ohlc,
          ibeg, iend, position, stopLoss, stopTrailing, profitTarget, maxDays, tickSize,
-         iendOut, exitPrice, gain, minPrice, maxPrice, mae, mfe, reason);
+         iendOut, exitPrice, gain, minPrice, maxPrice, mae, mfe, reason, index);
 
    /* Just some values for testing
    for(int ii = 0; ii < ibeg.size(); ++ii )
@@ -724,14 +692,30 @@ Rcpp::List processTradesInterface(
                Rcpp::Named("Reason") = reason);
 }
 
+void tradesToZeroBased(std::vector<int> & ibeg, std::vector<int> & iend, int size)
+{
+   if(ibeg.size() != iend.size()) Rcpp::stop("the entries and the exits must have the same length");
+
+   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
+   {
+      if(ibeg[ii] == NA_INTEGER || iend[ii] == NA_INTEGER ||
+            ibeg[ii] < 1 || ibeg[ii] > iend[ii] || iend[ii] > size) {
+         Rcpp::stop("the trades must be within the bars, entry before exit");
+      }
+      ibeg[ii] -= 1;
+      iend[ii] -= 1;
+   }
+}
+
 void tradesFromIndicator(
-         const std::vector<double> & indicator,
+         const double * indicator,
+         int size,
          std::vector<int> & ibeg,
          std::vector<int> & iend,
          std::vector<int> & position)
 {
    // The last index needs special processing
-   int lastId = indicator.size() - 1;
+   int lastId = size - 1;
    
    int ii = 0;
    // Skipt starting NAs
@@ -776,14 +760,33 @@ void tradesFromIndicator(
    assert(iend.size() == ibeg.size());
 }
 
+// The trades of either a dense indicator or its runs (an "rle" object). Returns
+// the number of bars.
+int tradesFromIndicator(
+         SEXP indicatorIn,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position)
+{
+   if(isRle(indicatorIn)) {
+      IndicatorRuns runs;
+      runsFromRle(indicatorIn, runs);
+      tradesFromRuns(runs, ibeg, iend, position);
+      return runs.size;
+   }
+
+   Rcpp::NumericVector indicator(indicatorIn);
+   tradesFromIndicator(indicator.begin(), indicator.size(), ibeg, iend, position);
+   return indicator.size();
+}
+
 // [[Rcpp::export("trades.from.indicator.interface")]]
 Rcpp::List tradesFromIndicatorInterface(SEXP indicatorIn)
 {
-   std::vector<double> indicator = Rcpp::as< std::vector<double> >( indicatorIn );
    std::vector<int> ibeg;
    std::vector<int> iend;
    std::vector<int> position;
-   tradesFromIndicator(indicator, ibeg, iend, position);
+   tradesFromIndicator(indicatorIn, ibeg, iend, position);
    
    // vectors in c++ are zero based and in R are one based.
    // convert to the R format on the way out.
@@ -800,7 +803,8 @@ Rcpp::List tradesFromIndicatorInterface(SEXP indicatorIn)
 }
 
 void calculateReturns(
-         const std::vector<double> & cl,
+         const double * cl,
+         int size,
          const std::vector<int> & ibeg,
          const std::vector<int> & iend,
          const std::vector<int> & position,
@@ -808,7 +812,7 @@ void calculateReturns(
          bool inDollars,
          std::vector<double> & returns)
 {
-   returns.resize(cl.size(), 0.0);
+   returns.resize(size, 0.0);
 
    if(!inDollars) {
       // Cycle through the trades
@@ -844,22 +848,119 @@ Rcpp::NumericVector calculateReturnsInterface(
                         SEXP exitPriceIn,
                         bool inDollars)
 {
-   // Convert inputs into std vectors
-   std::vector<double> cl = Rcpp::as< std::vector<double> >(clIn);
+   // Borrow the prices (or the close of a bar session), convert the rest into std vectors
+   const double * cl;
+   int size;
+   Rcpp::NumericVector clVector;
+   BarSession * session = barSession(clIn);
+   if(session != NULL) {
+      cl = session->close();
+      size = session->size();
+   } else {
+      clVector = Rcpp::NumericVector(clIn);
+      cl = clVector.begin();
+      size = clVector.size();
+   }
+
    std::vector<int> ibeg = Rcpp::as< std::vector<int> >(ibegIn);
    std::vector<int> iend = Rcpp::as< std::vector<int> >(iendIn);
    std::vector<int> position = Rcpp::as< std::vector<int> >(positionIn);
    std::vector<double> exitPrice = Rcpp::as< std::vector<double> >(exitPriceIn);
+   if(position.size() != ibeg.size() || exitPrice.size() != ibeg.size()) {
+      Rcpp::stop("the trade vectors must have the same length");
+   }
  
-   // c++ uses 0 based indexes
-   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
+   // c++ uses 0 based indexes. The exit bar's return needs the close before it.
+   tradesToZeroBased(ibeg, iend, size);
+   for(std::vector<int>::size_type ii = 0; ii < iend.size(); ++ii)
    {
-      ibeg[ii] -= 1;
-      iend[ii] -= 1;
+      if(iend[ii] < 1) Rcpp::stop("a trade can't exit on the first bar");
    }
    
    std::vector<double> result;
-   calculateReturns(cl, ibeg, iend, position, exitPrice, inDollars, result);
+   calculateReturns(cl, size, ibeg, iend, position, exitPrice, inDollars, result);
 
    return Rcpp::NumericVector(result.begin(), result.end());
+}
+
+// Trades an indicator with the same stop/profit settings for all trades and
+// computes the returns of the result - the whole trade.indicator/calculate.returns
+// pipeline in a single call. The indicator, dense or its runs, must be aligned
+// with the ohlc.
+// [[Rcpp::export("trade.indicator.interface")]]
+Rcpp::List tradeIndicatorInterface(
+                     SEXP ohlcIn,
+                     SEXP indicatorIn,
+                     double stopLoss,
+                     double stopTrailing,
+                     double profitTarget,
+                     int maxDays,
+                     double tickSize,
+                     bool inDollars)
+{
+   OhlcArg ohlcArg(ohlcIn);
+   const Ohlc & ohlc = ohlcArg.ohlc();
+
+   std::vector<int> ibeg;
+   std::vector<int> iend;
+   std::vector<int> position;
+   if(tradesFromIndicator(indicatorIn, ibeg, iend, position) != ohlc.size) {
+      Rcpp::stop("the indicator and the ohlc must have the same number of bars");
+   }
+
+   // The settings are the same for all trades
+   std::vector<double> stopLossIn(ibeg.size(), stopLoss);
+   std::vector<double> stopTrailingIn(ibeg.size(), stopTrailing);
+   std::vector<double> profitTargetIn(ibeg.size(), profitTarget);
+   std::vector<int> maxDaysIn(ibeg.size(), maxDays);
+
+   // Only the trades without a trailing stop benefit from the range index
+   double bars = 0;
+   if(isNA(stopTrailing)) {
+      for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii) bars += iend[ii] - ibeg[ii];
+   }
+   const RangeIndex * index = ohlcArg.rangeIndex(bars);
+
+   std::vector<int> iendOut;
+   std::vector<double> exitPrice;
+   std::vector<double> minPrice;
+   std::vector<double> maxPrice;
+   std::vector<double> gain;
+   std::vector<double> mae;
+   std::vector<double> mfe;
+   std::vector<int> reason;
+
+   processTrades(
+         ohlc,
+         ibeg, iend, position, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn, tickSize,
+         iendOut, exitPrice, gain, minPrice, maxPrice, mae, mfe, reason, index);
+
+   // The returns follow the actual exits
+   std::vector<double> returns;
+   calculateReturns(ohlc.cl, ohlc.size, ibeg, iendOut, position, exitPrice, inDollars, returns);
+
+   // vectors in c++ are zero based and in R are one based.
+   // convert to the R format on the way out.
+   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
+   {
+      ibeg[ii] += 1;
+      iendOut[ii] += 1;
+   }
+
+   return Rcpp::List::create(
+               Rcpp::Named("trades") = Rcpp::DataFrame::create(
+                     Rcpp::Named("Entry") = ibeg,
+                     Rcpp::Named("Exit") = iendOut,
+                     Rcpp::Named("Position") = position,
+                     Rcpp::Named("StopLoss") = stopLossIn,
+                     Rcpp::Named("StopTrailing") = stopTrailingIn,
+                     Rcpp::Named("ProfitTarget") = profitTargetIn,
+                     Rcpp::Named("ExitPrice") = exitPrice,
+                     Rcpp::Named("Gain") = gain,
+                     Rcpp::Named("MinPrice") = minPrice,
+                     Rcpp::Named("MaxPrice") = maxPrice,
+                     Rcpp::Named("MAE") = mae,
+                     Rcpp::Named("MFE") = mfe,
+                     Rcpp::Named("Reason") = reason),
+               Rcpp::Named("returns") = Rcpp::NumericVector(returns.begin(), returns.end()));
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PROCESS_TRADES_H_INCLUDED
+#define PROCESS_TRADES_H_INCLUDED
+
+#include <vector>
+
+#include "common.h"
+
+#define EXIT_ON_LAST             0
+#define STOP_LIMIT_ON_OPEN       1
+#define STOP_LIMIT_ON_HIGH       2
+#define STOP_LIMIT_ON_LOW        3
+#define STOP_LIMIT_ON_CLOSE      4
+#define STOP_TRAILING_ON_OPEN    5
+#define STOP_TRAILING_ON_HIGH    6
+#define STOP_TRAILING_ON_LOW     7
+#define STOP_TRAILING_ON_CLOSE   8
+#define PROFIT_TARGET_ON_OPEN    9
+#define PROFIT_TARGET_ON_HIGH   10
+#define PROFIT_TARGET_ON_LOW    11
+#define PROFIT_TARGET_ON_CLOSE  12
+#define MAX_DAYS_LIMIT          13
+
+// The number of exit reasons above
+#define EXIT_REASONS            14
+
+// Borrowed columns of an OHLC series. The memory is owned elsewhere (an R matrix
+// for instance) and must outlive the struct.
+struct Ohlc {
+   const double * op;
+   const double * hi;
+   const double * lo;
+   const double * cl;
+   int size;
+};
+
+// The first four columns of the matrix are assumed to be open, high, low and close
+inline Ohlc ohlcFromMatrix(Rcpp::NumericMatrix & ohlcMatrix)
+{
+   if(ohlcMatrix.ncol() < 4) Rcpp::stop("the ohlc matrix must have at least four columns");
+
+   Ohlc ohlc;
+   ohlc.size = ohlcMatrix.nrow();
+   ohlc.op = ohlcMatrix.begin();
+   ohlc.hi = ohlc.op + ohlc.size;
+   ohlc.lo = ohlc.hi + ohlc.size;
+   ohlc.cl = ohlc.lo + ohlc.size;
+   return ohlc;
+}
+
+class RangeIndex;
+
+// The workhorse simulating a single trade. All indexes are 0 based. With an index,
+// trades without a trailing stop jump over the bars at which they can't exit.
+void processTrade(
+         const Ohlc & ohlc,
+         int ibeg,
+         int iend,
+         int pos,
+         double stopLoss,
+         double stopTrailing,
+         double profitTarget,
+         int maxDays,
+         double tickSize,
+         int & exitIndex,
+         double & exitPrice,
+         int & exitReason,
+         double & gain,
+         double & minPrice,
+         double & maxPrice,
+         double & mae,
+         double & mfe,
+         const RangeIndex * index = NULL);
+
+// processTrade over all trades, each with its own settings
+void processTrades(
+         const Ohlc & ohlc,
+         const std::vector<int> & ibeg,
+         const std::vector<int> & iend,
+         const std::vector<int> & position,
+         const std::vector<double> & stopLoss,
+         const std::vector<double> & stopTrailing,
+         const std::vector<double> & profitTarget,
+         const std::vector<int> & maxDays,
+         double tickSize,
+         std::vector<int> & iendOut,
+         std::vector<double> & exitPriceOut,
+         std::vector<double> & gainOut,
+         std::vector<double> & minPriceOut,
+         std::vector<double> & maxPriceOut,
+         std::vector<double> & maeOut,
+         std::vector<double> & mfeOut,
+         std::vector<int> & exitReasonOut,
+         const RangeIndex * index);
+
+// Converts the trades from R (1 based) to 0 based indexes. The workhorse functions
+// don't check the indexes, thus, stops unless each trade is within the size bars,
+// its entry not after its exit.
+void tradesToZeroBased(std::vector<int> & ibeg, std::vector<int> & iend, int size);
+
+// The trades of a dense indicator, appended to the vectors
+void tradesFromIndicator(
+         const double * indicator,
+         int size,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position);
+
+// The per-bar returns of the trades on the close, 0 outside the trades
+void calculateReturns(
+         const double * cl,
+         int size,
+         const std::vector<int> & ibeg,
+         const std::vector<int> & iend,
+         const std::vector<int> & position,
+         const std::vector<double> & exitPrice,
+         bool inDollars,
+         std::vector<double> & returns);
+
+#endif // PROCESS_TRADES_H_INCLUDED
@@ -0,0 +1,46 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "common.h"
+#include "rangeIndex.h"
+
+RangeIndex::RangeIndex(const Ohlc & ohlc)
+{
+   lows_.build(ohlc.lo, ohlc.size);
+   highs_.build(ohlc.hi, ohlc.size);
+
+   irregular_.resize(ohlc.size + 1);
+   irregular_[0] = 0;
+   for(int ii = 0; ii < ohlc.size; ++ii) {
+      // Written so that NAs (and NaNs) fail the test
+      bool regular =
+               ohlc.lo[ii] <= ohlc.op[ii] && ohlc.op[ii] <= ohlc.hi[ii] &&
+               ohlc.lo[ii] <= ohlc.cl[ii] && ohlc.cl[ii] <= ohlc.hi[ii];
+      irregular_[ii + 1] = irregular_[ii] + (regular ? 0 : 1);
+   }
+}
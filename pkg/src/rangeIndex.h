@@ -0,0 +1,191 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef RANGE_INDEX_H_INCLUDED
+#define RANGE_INDEX_H_INCLUDED
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "processTrades.h"
+
+// Minimums over ranges of a series, answered from per block minimums and a
+// sparse table over the blocks. Sign == -1 turns it into an index of maximums:
+// the minimums of the negated values (the negation is exact). Borrows the values.
+template <int Sign>
+class BlockMinIndex {
+public:
+   static const int BLOCK = 32;
+
+   BlockMinIndex() : values_(NULL), size_(0) {}
+
+   void build(const double * values, int size);
+
+   // The minimum of Sign*values over [from, to], +Inf for an empty range
+   double min(int from, int to) const;
+
+   // The first ii in [from, to] with Sign*values[ii] <= level, -1 if none
+   int find(int from, int to, double level) const;
+
+private:
+   double value(int ii) const { return Sign*values_[ii]; }
+   double scan(int from, int to) const;
+   double blocksMin(int bfrom, int bto) const;
+
+   const double * values_;
+   int size_;
+
+   // table_[kk][bb] is the minimum over blocks [bb, bb + 2^kk)
+   std::vector< std::vector<double> > table_;
+   std::vector<int> log2_;
+};
+
+// Minimum low and maximum high over bar ranges, and the first bar crossing a fixed
+// level, in O(log n) instead of a bar by bar scan.
+class RangeIndex {
+public:
+   explicit RangeIndex(const Ohlc & ohlc);
+
+   // Whether all bars in [from, to] have no NAs and the open and the close
+   // within [low, high]. The index answers are exact only for regular bars.
+   bool isRegular(int from, int to) const { return irregular_[to + 1] == irregular_[from]; }
+
+   double minLow(int from, int to) const { return lows_.min(from, to); }
+   double maxHigh(int from, int to) const { return -highs_.min(from, to); }
+
+   // The first bar in [from, to] with a low at or below level, -1 if none
+   int findLowAtOrBelow(int from, int to, double level) const { return lows_.find(from, to, level); }
+
+   // The first bar in [from, to] with a high at or above level, -1 if none
+   int findHighAtOrAbove(int from, int to, double level) const { return highs_.find(from, to, -level); }
+
+   // Whether building an index pays off when the trades will scan this many bars
+   static bool worthwhile(int size, double bars) { return bars > size; }
+
+private:
+   BlockMinIndex<1> lows_;
+   BlockMinIndex<-1> highs_;
+
+   // irregular_[ii] is the number of irregular bars before ii
+   std::vector<int> irregular_;
+};
+
+template <int Sign>
+void BlockMinIndex<Sign>::build(const double * values, int size)
+{
+   values_ = values;
+   size_ = size;
+
+   int blocks = (size + BLOCK - 1) / BLOCK;
+
+   log2_.resize(blocks + 1, 0);
+   for(int ii = 2; ii <= blocks; ++ii) log2_[ii] = log2_[ii / 2] + 1;
+
+   table_.clear();
+   table_.push_back(std::vector<double>(blocks));
+   for(int bb = 0; bb < blocks; ++bb) {
+      table_[0][bb] = scan(bb*BLOCK, std::min(size, (bb + 1)*BLOCK) - 1);
+   }
+
+   for(int kk = 1; (1 << kk) <= blocks; ++kk) {
+      const std::vector<double> & prev = table_[kk - 1];
+      std::vector<double> level(blocks - (1 << kk) + 1);
+      for(std::vector<double>::size_type bb = 0; bb < level.size(); ++bb) {
+         level[bb] = std::min(prev[bb], prev[bb + (1 << (kk - 1))]);
+      }
+      table_.push_back(level);
+   }
+}
+
+template <int Sign>
+double BlockMinIndex<Sign>::scan(int from, int to) const
+{
+   double res = std::numeric_limits<double>::infinity();
+   for(int ii = from; ii <= to; ++ii) res = std::min(value(ii), res);
+   return res;
+}
+
+template <int Sign>
+double BlockMinIndex<Sign>::blocksMin(int bfrom, int bto) const
+{
+   int kk = log2_[bto - bfrom + 1];
+   return std::min(table_[kk][bfrom], table_[kk][bto - (1 << kk) + 1]);
+}
+
+template <int Sign>
+double BlockMinIndex<Sign>::min(int from, int to) const
+{
+   if(to < from) return std::numeric_limits<double>::infinity();
+
+   int bfrom = from / BLOCK;
+   int bto = to / BLOCK;
+   if(bfrom == bto) return scan(from, to);
+
+   double res = std::min(scan(from, (bfrom + 1)*BLOCK - 1), scan(bto*BLOCK, to));
+   if(bfrom + 1 <= bto - 1) res = std::min(blocksMin(bfrom + 1, bto - 1), res);
+   return res;
+}
+
+template <int Sign>
+int BlockMinIndex<Sign>::find(int from, int to, double level) const
+{
+   if(to < from) return -1;
+
+   int bfrom = from / BLOCK;
+   int bto = to / BLOCK;
+
+   // The partial first block
+   int last = std::min(to, (bfrom + 1)*BLOCK - 1);
+   for(int ii = from; ii <= last; ++ii) {
+      if(value(ii) <= level) return ii;
+   }
+
+   if(bfrom == bto) return -1;
+
+   // The full blocks in between
+   int bb = bfrom + 1;
+   if(bb <= bto - 1 && blocksMin(bb, bto - 1) <= level) {
+      // Skip the longest run of blocks above the level, a power of two at a time
+      for(int kk = table_.size() - 1; kk >= 0; --kk) {
+         if(bb + (1 << kk) - 1 <= bto - 1 && table_[kk][bb] > level) bb += 1 << kk;
+      }
+
+      // bb is the first block with a value at or below the level
+      for(int ii = bb*BLOCK; ; ++ii) {
+         if(value(ii) <= level) return ii;
+      }
+   }
+
+   // The partial last block
+   for(int ii = bto*BLOCK; ii <= to; ++ii) {
+      if(value(ii) <= level) return ii;
+   }
+
+   return -1;
+}
+
+#endif // RANGE_INDEX_H_INCLUDED
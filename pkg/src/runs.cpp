@@ -0,0 +1,221 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "runs.h"
+
+void runsFromDense(const double * indicator, int size, IndicatorRuns & runs)
+{
+   runs.clear();
+   for(int ii = 0; ii < size; ++ii) runs.append(indicator[ii], 1);
+}
+
+void runsToDense(const IndicatorRuns & runs, double * indicator)
+{
+   DenseOutput output = { indicator };
+   for(int kk = 0; kk < runs.count(); ++kk) output.append(runs.values[kk], runs.length(kk));
+}
+
+void runsFromRle(SEXP rleIn, IndicatorRuns & runs)
+{
+   Rcpp::List rle(rleIn);
+   Rcpp::IntegerVector lengths = rle["lengths"];
+   Rcpp::NumericVector values = rle["values"];
+   if(lengths.size() != values.size()) Rcpp::stop("the lengths and the values of the runs must have the same size");
+
+   runs.clear();
+   for(int kk = 0; kk < lengths.size(); ++kk) {
+      if(lengths[kk] < 0) Rcpp::stop("the run lengths must be non-negative");
+      runs.append(values[kk], lengths[kk]);
+   }
+}
+
+Rcpp::List rleFromRuns(const IndicatorRuns & runs)
+{
+   Rcpp::IntegerVector lengths(runs.count());
+   for(int kk = 0; kk < runs.count(); ++kk) lengths[kk] = runs.length(kk);
+
+   Rcpp::List res = Rcpp::List::create(
+                        Rcpp::Named("lengths") = lengths,
+                        Rcpp::Named("values") = Rcpp::NumericVector(runs.values.begin(), runs.values.end()));
+   res.attr("class") = "rle";
+   return res;
+}
+
+// Follows the dense version bar by bar, except that a step consumes the part
+// of a run the dense loop would walk through. The dense version reads each
+// value before overwriting it, thus, the walk only looks at the input runs.
+void capTradeDuration(
+         const IndicatorRuns & runs,
+         int shortMinCap,
+         int longMinCap,
+         int shortMaxCap,
+         int longMaxCap,
+         bool waitNewSignal,
+         IndicatorRuns & capped)
+{
+   capped.clear();
+
+   if(shortMaxCap < 0 && longMaxCap < 0 && shortMinCap < 0 && longMinCap < 0) {
+      capped = runs;
+      return;
+   }
+
+   int size = runs.size;
+   int pos = 0;   // The current bar
+   int kk = 0;    // The run containing it
+
+   // Consumes the rest of the current run, or count bars of it
+   auto take = [&](int count) {
+      int len = std::min(count, runs.end(kk) - pos);
+      pos += len;
+      if(pos == runs.end(kk)) ++kk;
+      return len;
+   };
+
+   // Copies the rest of the current run unchanged
+   auto copy = [&]() {
+      double value = runs.values[kk];
+      capped.append(value, take(size));
+   };
+
+   // Skip leading NAs
+   while(pos < size && isNA(runs.values[kk])) copy();
+
+   while(pos < size) {
+      // Find the beginning of a position
+      if(runs.values[kk] == 0) {
+         copy();
+         continue;
+      }
+
+      // Apply caps to this position
+      int ss = sign(runs.values[kk]);
+      int minCap = -1, maxCap = -1;
+      if(ss == -1) {
+         minCap = shortMinCap;
+         maxCap = shortMaxCap;
+      } else if(ss == 1) {
+         minCap = longMinCap;
+         maxCap = longMaxCap;
+      }
+
+      if(minCap != -1 || maxCap != -1) {
+         int daysIn = 1;
+         bool done = false;
+         int prevIndSign = -10;
+         while(pos < size && daysIn <= minCap) {
+            double value = runs.values[kk];
+            int indSign = sign(value);
+            if(indSign != ss) done = true;
+            prevIndSign = indSign;
+
+            int len = take(minCap - daysIn + 1);
+            capped.append(indSign != ss ? ss : value, len);
+            daysIn += len;
+         }
+
+         if(done && waitNewSignal) {
+            while(pos < size && sign(runs.values[kk]) == prevIndSign) capped.append(0, take(size));
+         }
+
+         if(!done || !waitNewSignal) {
+            while(pos < size && sign(runs.values[kk]) == ss) {
+               double value = runs.values[kk];
+               int len = take(size);
+
+               // The bars over maxCap are zeroed
+               int keep = len;
+               if(maxCap > -1) keep = std::max(0, std::min(len, maxCap - daysIn + 1));
+               capped.append(value, keep);
+               capped.append(0, len - keep);
+               daysIn += len;
+            }
+         }
+      } else {
+         while(pos < size && sign(runs.values[kk]) == ss) copy();
+      }
+   }
+}
+
+void tradesFromRuns(
+         const IndicatorRuns & runs,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position)
+{
+   // The last index needs special processing
+   int lastId = runs.size - 1;
+
+   // Skip starting NAs
+   int kk = 0;
+   if(runs.count() > 0 && isNA(runs.values[0])) kk = 1;
+
+   int ii = kk < runs.count() ? std::min(runs.starts[kk], lastId) : lastId;
+   if(ii < lastId) {
+      // Process the first element
+      if(runs.values[kk] != 0.0) {
+         ibeg.push_back(ii);
+         position.push_back(runs.values[kk]);
+      }
+
+      // Each later run starting before the last bar is a change
+      for(++kk; kk < runs.count() && runs.starts[kk] < lastId; ++kk) {
+         ii = runs.starts[kk];
+
+         // Close the open position
+         if(runs.values[kk-1] != 0.0) iend.push_back(ii);
+
+         // Open a new position
+         if(runs.values[kk] != 0.0) {
+            ibeg.push_back(ii);
+            position.push_back(runs.values[kk]);
+         }
+      }
+   }
+
+   if(ibeg.size() > iend.size()) iend.push_back(lastId);
+}
+
+// [[Rcpp::export("indicator.runs.interface")]]
+Rcpp::List indicatorRunsInterface(SEXP indicatorIn)
+{
+   Rcpp::NumericVector indicator(indicatorIn);
+   IndicatorRuns runs;
+   runsFromDense(indicator.begin(), indicator.size(), runs);
+   return rleFromRuns(runs);
+}
+
+// [[Rcpp::export("indicator.dense.interface")]]
+Rcpp::NumericVector indicatorDenseInterface(SEXP runsIn)
+{
+   IndicatorRuns runs;
+   runsFromRle(runsIn, runs);
+   Rcpp::NumericVector res(runs.size);
+   runsToDense(runs, res.begin());
+   return res;
+}
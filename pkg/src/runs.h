@@ -0,0 +1,97 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef RUNS_H_INCLUDED
+#define RUNS_H_INCLUDED
+
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+
+// An indicator as the runs of equal values, in order. A run spans the bars
+// [starts[kk], starts[kk+1]), the last one ends at size. Leading NAs form a
+// single run.
+struct IndicatorRuns {
+   std::vector<int> starts;
+   std::vector<double> values;
+   int size;
+
+   IndicatorRuns() : size(0) {}
+
+   int count() const { return starts.size(); }
+   int end(int kk) const { return kk + 1 < count() ? starts[kk + 1] : size; }
+   int length(int kk) const { return end(kk) - starts[kk]; }
+
+   // Appends length bars of value, merging them with the last run if equal
+   void append(double value, int length)
+   {
+      if(length <= 0) return;
+      if(values.empty() || !sameValue(values.back(), value)) {
+         starts.push_back(size);
+         values.push_back(value);
+      }
+      size += length;
+   }
+
+   void clear() { starts.clear(); values.clear(); size = 0; }
+
+   static bool sameValue(double a, double b) { return a == b || (isNA(a) && isNA(b)); }
+};
+
+// Writes the bars of the runs to a dense array
+struct DenseOutput {
+   double * out;
+   void append(double value, int length) { out = std::fill_n(out, length, value); }
+};
+
+void runsFromDense(const double * indicator, int size, IndicatorRuns & runs);
+void runsToDense(const IndicatorRuns & runs, double * indicator);
+
+// R keeps runs as "rle" objects - a list of lengths and values
+inline bool isRle(SEXP in) { return Rf_inherits(in, "rle"); }
+void runsFromRle(SEXP rleIn, IndicatorRuns & runs);
+Rcpp::List rleFromRuns(const IndicatorRuns & runs);
+
+// The caps of capTradeDuration applied to runs. The output is the runs of the
+// capped indicator, thus, the cost is in the number of runs, not bars.
+void capTradeDuration(
+         const IndicatorRuns & runs,
+         int shortMinCap,
+         int longMinCap,
+         int shortMaxCap,
+         int longMaxCap,
+         bool waitNewSignal,
+         IndicatorRuns & capped);
+
+// The trades tradesFromIndicator produces for the dense form of the runs
+void tradesFromRuns(
+         const IndicatorRuns & runs,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position);
+
+#endif // RUNS_H_INCLUDED
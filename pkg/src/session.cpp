@@ -0,0 +1,224 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+#include "session.h"
+
+using namespace Rcpp;
+
+BarSession::BarSession(const Rcpp::NumericMatrix & ohlcMatrix, const std::vector<double> & timesIn)
+{
+   int rows = ohlcMatrix.nrow();
+
+   if(ohlcMatrix.ncol() < 4) Rcpp::stop("the ohlc matrix must have at least four columns");
+   if(static_cast<int>(timesIn.size()) != rows) Rcpp::stop("the index and the ohlc matrix must have the same number of rows");
+
+   for(std::vector<double>::size_type ii = 1; ii < timesIn.size(); ++ii) {
+      if(!(timesIn[ii-1] <= timesIn[ii])) Rcpp::stop("the index must be in increasing order");
+   }
+
+   columns_.assign(ohlcMatrix.begin(), ohlcMatrix.begin() + 4*rows);
+   columns_.insert(columns_.end(), timesIn.begin(), timesIn.end());
+
+   const double * base = columns_.data();
+   ohlc_.op = base;
+   ohlc_.hi = base + rows;
+   ohlc_.lo = base + 2*rows;
+   ohlc_.cl = base + 3*rows;
+   ohlc_.size = rows;
+   times_ = base + 4*rows;
+}
+
+// The store validates the times when opened
+BarSession::BarSession(std::unique_ptr<BarStore> store)
+   : store_(std::move(store))
+{
+   ohlc_.op = store_->column(BarStore::OPEN);
+   ohlc_.hi = store_->column(BarStore::HIGH);
+   ohlc_.lo = store_->column(BarStore::LOW);
+   ohlc_.cl = store_->column(BarStore::CLOSE);
+   ohlc_.size = store_->rows();
+   times_ = store_->column(BarStore::TIMES);
+}
+
+int BarSession::find(double time) const
+{
+   const double * end = times_ + size();
+   const double * it = std::lower_bound(times_, end, time);
+   if(it == end || *it != time) return -1;
+   return it - times_;
+}
+
+const RangeIndex & BarSession::rangeIndex()
+{
+   if(!index_) index_.reset(new RangeIndex(ohlc()));
+   return *index_;
+}
+
+BarSession * barSession(SEXP in)
+{
+   if(TYPEOF(in) != EXTPTRSXP) return NULL;
+   return unwrapPointer<BarSession>(in, BAR_SESSION);
+}
+
+OhlcArg::OhlcArg(SEXP in)
+{
+   session_ = barSession(in);
+   if(session_ != NULL) {
+      ohlc_ = session_->ohlc();
+   } else {
+      matrix_ = Rcpp::NumericMatrix(in);
+      ohlc_ = ohlcFromMatrix(matrix_);
+   }
+}
+
+const RangeIndex * OhlcArg::rangeIndex(double bars)
+{
+   if(session_ != NULL) return &session_->rangeIndex();
+
+   if(!index_ && RangeIndex::worthwhile(ohlc_.size, bars)) index_.reset(new RangeIndex(ohlc_));
+   return index_.get();
+}
+
+PricesArg::PricesArg(SEXP in)
+{
+   BarSession * session = barSession(in);
+   if(session != NULL) {
+      prices_ = session->close();
+      size_ = session->size();
+   } else {
+      vector_ = Rcpp::NumericVector(in);
+      prices_ = vector_.begin();
+      size_ = vector_.size();
+   }
+}
+
+// [[Rcpp::export("bar.session.interface")]]
+SEXP barSessionInterface(SEXP ohlcIn, SEXP timesIn)
+{
+   Rcpp::NumericMatrix ohlcMatrix(ohlcIn);
+   std::vector<double> times = Rcpp::as< std::vector<double> >(timesIn);
+
+   return wrapPointer(new BarSession(ohlcMatrix, times), BAR_SESSION);
+}
+
+// [[Rcpp::export("bar.session.which.interface")]]
+Rcpp::IntegerVector barSessionWhichInterface(SEXP sessionIn, SEXP timesIn)
+{
+   BarSession * session = barSession(sessionIn);
+   if(session == NULL) Rcpp::stop("not a bar session");
+
+   Rcpp::NumericVector times(timesIn);
+   Rcpp::IntegerVector res(times.size());
+   for(R_xlen_t ii = 0; ii < times.size(); ++ii) {
+      int id = session->find(times[ii]);
+      // R indexes are 1 based
+      res[ii] = id < 0 ? NA_INTEGER : id + 1;
+   }
+
+   return res;
+}
+
+// [[Rcpp::export("bar.session.size.interface")]]
+int barSessionSizeInterface(SEXP sessionIn)
+{
+   BarSession * session = barSession(sessionIn);
+   if(session == NULL) Rcpp::stop("not a bar session");
+
+   return session->size();
+}
+
+// ohlcIn has the open, high, low, close, volume and adjusted columns
+// [[Rcpp::export("bar.store.write.interface")]]
+void barStoreWriteInterface(std::string path, SEXP ohlcIn, SEXP timesIn, bool dateIndex)
+{
+   Rcpp::NumericMatrix ohlcMatrix(ohlcIn);
+   Rcpp::NumericVector times(timesIn);
+   int rows = ohlcMatrix.nrow();
+
+   if(ohlcMatrix.ncol() != BarStore::COLUMNS - 1) Rcpp::stop("the bars must have six columns");
+   if(times.size() != rows) Rcpp::stop("the index and the ohlc matrix must have the same number of rows");
+   for(int ii = 1; ii < rows; ++ii) {
+      if(!(times[ii-1] <= times[ii])) Rcpp::stop("the index must be in increasing order");
+   }
+
+   const double * columns[BarStore::COLUMNS];
+   columns[BarStore::TIMES] = times.begin();
+   for(int cc = BarStore::OPEN; cc < BarStore::COLUMNS; ++cc) {
+      columns[cc] = ohlcMatrix.begin() + (cc - BarStore::OPEN)*rows;
+   }
+
+   std::string error;
+   if(!BarStore::write(path, columns, rows, dateIndex, error)) Rcpp::stop(error);
+}
+
+std::unique_ptr<BarStore> openBarStore(const std::string & path)
+{
+   std::unique_ptr<BarStore> store(new BarStore());
+   std::string error;
+   if(!store->open(path, error)) Rcpp::stop(error);
+   return store;
+}
+
+Rcpp::List barStoreSession(std::unique_ptr<BarStore> store)
+{
+   bool dateIndex = store->dateIndex();
+   BarSession * session = new BarSession(std::move(store));
+
+   return Rcpp::List::create(
+               Rcpp::Named("ptr") = wrapPointer(session, BAR_SESSION),
+               Rcpp::Named("times") = Rcpp::NumericVector(session->times(), session->times() + session->size()),
+               Rcpp::Named("date") = dateIndex);
+}
+
+// [[Rcpp::export("bar.store.session.interface")]]
+Rcpp::List barStoreSessionInterface(std::string path)
+{
+   return barStoreSession(openBarStore(path));
+}
+
+// A copy of all columns
+// [[Rcpp::export("bar.store.read.interface")]]
+Rcpp::List barStoreReadInterface(std::string path)
+{
+   std::unique_ptr<BarStore> store = openBarStore(path);
+   int rows = store->rows();
+
+   Rcpp::NumericMatrix bars(rows, (int)BarStore::COLUMNS - 1);
+   for(int cc = BarStore::OPEN; cc < BarStore::COLUMNS; ++cc) {
+      const double * column = store->column(static_cast<BarStore::Column>(cc));
+      std::copy(column, column + rows, bars.begin() + (cc - BarStore::OPEN)*rows);
+   }
+
+   const double * times = store->column(BarStore::TIMES);
+   return Rcpp::List::create(
+               Rcpp::Named("bars") = bars,
+               Rcpp::Named("times") = Rcpp::NumericVector(times, times + rows),
+               Rcpp::Named("date") = store->dateIndex());
+}
@@ -0,0 +1,118 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SESSION_H_INCLUDED
+#define SESSION_H_INCLUDED
+
+#include <vector>
+#include <memory>
+
+#include "common.h"
+#include "processTrades.h"
+#include "rangeIndex.h"
+#include "barStore.h"
+
+// An OHLC series converted and validated once, then handed to the interface
+// functions through an external pointer instead of the xts object. The columns
+// are either copies owned by the session, or borrowed from a mapped bar store
+// which the session keeps open.
+class BarSession {
+public:
+   BarSession(const Rcpp::NumericMatrix & ohlcMatrix, const std::vector<double> & timesIn);
+   explicit BarSession(std::unique_ptr<BarStore> store);
+
+   int size() const { return ohlc_.size; }
+
+   Ohlc ohlc() const { return ohlc_; }
+   const double * close() const { return ohlc_.cl; }
+
+   // The time index, as numbers, in increasing order
+   const double * times() const { return times_; }
+
+   // The 0 based position of time, -1 if time is not in the index
+   int find(double time) const;
+
+   // Built on first use, then reused by all calls on the session
+   const RangeIndex & rangeIndex();
+
+   // The range index if already built, NULL otherwise. Doesn't build it, thus,
+   // safe to call while the workers use the session.
+   const RangeIndex * builtRangeIndex() const { return index_.get(); }
+
+   // The store behind the session, NULL if the session owns the columns
+   const BarStore * store() const { return store_.get(); }
+
+private:
+   // Open, high, low, close and the times, unless borrowed from the store
+   std::vector<double> columns_;
+   std::unique_ptr<BarStore> store_;
+
+   Ohlc ohlc_;
+   const double * times_;
+
+   std::unique_ptr<RangeIndex> index_;
+};
+
+// The tag of the external pointers to the sessions
+#define BAR_SESSION "bar session"
+
+// The session behind an external pointer, NULL if the argument is not an external
+// pointer. Fails for the external pointers to anything else.
+BarSession * barSession(SEXP in);
+
+// A session over the mapped store, as the R side expects it: the external pointer
+// plus the times and the kind of the index, to rebuild the index
+Rcpp::List barStoreSession(std::unique_ptr<BarStore> store);
+
+// Either a bar session or an ohlc matrix, borrowed for the duration of a call
+class OhlcArg {
+public:
+   explicit OhlcArg(SEXP in);
+   const Ohlc & ohlc() const { return ohlc_; }
+
+   // The range index for trades scanning this many bars in total. A session's
+   // index is always used, a matrix gets one only if it pays off (NULL otherwise).
+   const RangeIndex * rangeIndex(double bars);
+private:
+   Rcpp::NumericMatrix matrix_;
+   Ohlc ohlc_;
+   BarSession * session_;
+   std::unique_ptr<RangeIndex> index_;
+};
+
+// Either the close of a bar session or a numeric vector, borrowed for the duration of a call
+class PricesArg {
+public:
+   explicit PricesArg(SEXP in);
+   const double * prices() const { return prices_; }
+   int size() const { return size_; }
+private:
+   Rcpp::NumericVector vector_;
+   const double * prices_;
+   int size_;
+};
+
+#endif // SESSION_H_INCLUDED
@@ -0,0 +1,201 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "signals.h"
+#include "session.h"
+#include "laguerre.h"
+#include "zigZag.h"
+
+void packSignals(const int * logicals, int size, PackedSignals & signals)
+{
+   signals.resize(size);
+   for(int ww = 0; ww < (int)signals.words.size(); ++ww) {
+      int beg = ww*64;
+      int end = std::min(beg + 64, size);
+      uint64_t word = 0;
+      for(int ii = beg; ii < end; ++ii) {
+         word |= uint64_t(logicals[ii] != 0) << (ii - beg);
+      }
+      signals.words[ww] = word;
+   }
+}
+
+void crossSignals(
+         const double * a,
+         int aStride,
+         const double * b,
+         int bStride,
+         int size,
+         int direction,
+         PackedSignals & signals)
+{
+   signals.resize(size);
+   Crossing crossing(direction);
+   for(int ii = 0; ii < size; ++ii) {
+      if(crossing.step(a[ii*aStride], b[ii*bStride])) signals.set(ii);
+   }
+}
+
+void laguerreRsiSignals(
+         const double * prices,
+         int size,
+         double gamma,
+         double threshold,
+         int direction,
+         PackedSignals & signals)
+{
+   signals.resize(size);
+   Crossing crossing(direction);
+   LaguerreState state(gamma);
+   for(int ii = 0; ii < size; ++ii) {
+      state.update(prices[ii]);
+      double rsi = ii < 4 ? NA_REAL : state.rsi();
+      if(crossing.step(rsi, threshold)) signals.set(ii);
+   }
+}
+
+void zigZagSignals(
+         const double * close,
+         int size,
+         const double * changes,
+         int changesStride,
+         bool percent,
+         int direction,
+         PackedSignals & signals)
+{
+   signals.resize(size);
+   ZigZag zz(percent);
+   int prev = 0;
+   for(int ii = 0; ii < size; ++ii) {
+      int indicator, age;
+      double inflection, target, correction;
+      zz.step(close[ii], changes[ii*changesStride], indicator, inflection, target, correction, age);
+      if(indicator == direction && prev != direction) signals.set(ii);
+      prev = indicator;
+   }
+}
+
+void signalsFromArg(SEXP in, PackedSignals & signals)
+{
+   if(Rf_inherits(in, "packed.signals")) {
+      if(TYPEOF(in) != RAWSXP) Rcpp::stop("the packed signals must be a raw vector");
+
+      Rcpp::RawVector bytes(in);
+      SEXP sizeIn = bytes.attr("size");
+      int size = Rf_length(sizeIn) == 1 ? Rcpp::as<int>(sizeIn) : -1;
+      if(size < 0 || 8*PackedSignals::wordCount(size) != bytes.size()) {
+         Rcpp::stop("the size of the packed signals doesn't match the words");
+      }
+
+      signals.resize(size);
+      if(size > 0) {
+         const unsigned char * byte = bytes.begin();
+         for(std::size_t ww = 0; ww < signals.words.size(); ++ww) {
+            uint64_t word = 0;
+            for(int bb = 7; bb >= 0; --bb) word = (word << 8) | byte[8*ww + bb];
+            signals.words[ww] = word;
+         }
+
+         // Clear the bits past the last bar
+         int tail = signals.size % 64;
+         if(tail != 0) signals.words.back() &= (uint64_t(1) << tail) - 1;
+      }
+      return;
+   }
+
+   Rcpp::LogicalVector logicals(in);
+   packSignals(logicals.begin(), logicals.size(), signals);
+}
+
+Rcpp::RawVector signalsToR(const PackedSignals & signals)
+{
+   Rcpp::RawVector res(8*signals.words.size());
+   unsigned char * byte = res.begin();
+   for(std::size_t ww = 0; ww < signals.words.size(); ++ww) {
+      uint64_t word = signals.words[ww];
+      for(int bb = 0; bb < 8; ++bb, word >>= 8) byte[8*ww + bb] = word & 0xff;
+   }
+   res.attr("size") = signals.size;
+   res.attr("class") = "packed.signals";
+   return res;
+}
+
+// [[Rcpp::export("pack.signals.interface")]]
+Rcpp::RawVector packSignalsInterface(SEXP signalsIn)
+{
+   PackedSignals signals;
+   signalsFromArg(signalsIn, signals);
+   return signalsToR(signals);
+}
+
+// [[Rcpp::export("unpack.signals.interface")]]
+Rcpp::LogicalVector unpackSignalsInterface(SEXP signalsIn)
+{
+   PackedSignals signals;
+   signalsFromArg(signalsIn, signals);
+   Rcpp::LogicalVector res(signals.size);
+   for(int ii = 0; ii < signals.size; ++ii) res[ii] = signals.get(ii);
+   return res;
+}
+
+// y is either a series or a constant
+// [[Rcpp::export("cross.signals.interface")]]
+Rcpp::RawVector crossSignalsInterface(SEXP xIn, SEXP yIn, int direction)
+{
+   PricesArg x(xIn);
+   Rcpp::NumericVector y(yIn);
+   if(y.size() != 1 && y.size() != x.size()) Rcpp::stop("y must be a constant or have the same length as x");
+
+   PackedSignals signals;
+   crossSignals(x.prices(), 1, y.begin(), y.size() == 1 ? 0 : 1, x.size(), direction, signals);
+   return signalsToR(signals);
+}
+
+// [[Rcpp::export("laguerre.rsi.signals.interface")]]
+Rcpp::RawVector laguerreRsiSignalsInterface(SEXP pricesIn, double gamma, double threshold, int direction)
+{
+   PricesArg prices(pricesIn);
+   PackedSignals signals;
+   laguerreRsiSignals(prices.prices(), prices.size(), gamma, threshold, direction, signals);
+   return signalsToR(signals);
+}
+
+// changes is either a threshold per bar or a constant
+// [[Rcpp::export("zig.zag.signals.interface")]]
+Rcpp::RawVector zigZagSignalsInterface(SEXP pricesIn, SEXP changesIn, bool percent, int direction)
+{
+   PricesArg prices(pricesIn);
+   Rcpp::NumericVector changes(changesIn);
+   if(changes.size() != 1 && changes.size() != prices.size()) {
+      Rcpp::stop("the changes must be a constant or have the same length as the prices");
+   }
+
+   PackedSignals signals;
+   zigZagSignals(prices.prices(), prices.size(), changes.begin(), changes.size() == 1 ? 0 : 1, percent, direction, signals);
+   return signalsToR(signals);
+}
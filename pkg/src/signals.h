@@ -0,0 +1,125 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SIGNALS_H_INCLUDED
+#define SIGNALS_H_INCLUDED
+
+#include <vector>
+#include <stdint.h>
+
+#include "common.h"
+
+// Signals (entries, exits, crossings) packed 64 to a word - bar ii is bit ii % 64
+// of word ii / 64. The bits past size in the last word are always 0.
+struct PackedSignals {
+   std::vector<uint64_t> words;
+   int size;
+
+   PackedSignals() : size(0) {}
+
+   static int wordCount(int size) { return (size + 63) / 64; }
+
+   void resize(int newSize) { size = newSize; words.assign(wordCount(size), 0); }
+   void set(int ii) { words[ii / 64] |= uint64_t(1) << (ii % 64); }
+   bool get(int ii) const { return (words[ii / 64] >> (ii % 64)) & 1; }
+};
+
+// The index of the lowest set bit, word must not be 0
+inline int lowestBit(uint64_t word)
+{
+#if defined(__GNUC__)
+   return __builtin_ctzll(word);
+#else
+   int res = 0;
+   while(!(word & 1)) {
+      word >>= 1;
+      ++res;
+   }
+   return res;
+#endif
+}
+
+// Crossings of a series over another (direction 1) or under it (direction -1),
+// one bar at a time. A bar crosses if it is over and the previous bar is not
+// over - the same as x > y & lag(x) <= lag(y) in R, with NAs not crossing.
+class Crossing {
+public:
+   explicit Crossing(int direction) : direction_(direction), prevNotOver_(false) {}
+
+   bool step(double a, double b) {
+      bool over = direction_ > 0 ? a > b : a < b;
+      bool res = over && prevNotOver_;
+      prevNotOver_ = direction_ > 0 ? a <= b : a >= b;
+      return res;
+   }
+
+private:
+   int direction_;
+   bool prevNotOver_;
+};
+
+// The signal kernels write their bars straight into packed signals. The strides
+// allow constants (a stride of 0) in place of series.
+void crossSignals(
+         const double * a,
+         int aStride,
+         const double * b,
+         int bStride,
+         int size,
+         int direction,
+         PackedSignals & signals);
+
+// The crossings of the laguerre RSI over or under threshold. Like in laguerre.rsi
+// the first four bars are NAs.
+void laguerreRsiSignals(
+         const double * prices,
+         int size,
+         double gamma,
+         double threshold,
+         int direction,
+         PackedSignals & signals);
+
+// The bars at which the zig-zag turns to a swing in direction
+void zigZagSignals(
+         const double * close,
+         int size,
+         const double * changes,
+         int changesStride,
+         bool percent,
+         int direction,
+         PackedSignals & signals);
+
+// R logicals, like the earlier conversion to std::vector<bool> NAs are true
+void packSignals(const int * logicals, int size, PackedSignals & signals);
+
+// In R the words are a raw vector of class "packed.signals", 8 bytes per word, the
+// low byte first, with the number of bars in the "size" attribute. Not a numeric
+// vector - R may quiet the NaN bit patterns of a double and flip the signals. The
+// argument is either such a vector or a logical one.
+void signalsFromArg(SEXP in, PackedSignals & signals);
+Rcpp::RawVector signalsToR(const PackedSignals & signals);
+
+#endif // SIGNALS_H_INCLUDED
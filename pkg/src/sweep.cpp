@@ -0,0 +1,474 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cmath>
+
+#include "common.h"
+#include "processTrades.h"
+#include "parallel.h"
+#include "performance.h"
+#include "session.h"
+
+using namespace Rcpp;
+
+// Runs all trades through each parameter set of the grid. The output vectors are
+// laid out by parameter set: the result for trade ii under parameter set gg is at
+// gg*ibeg.size() + ii. Each parameter set is a separate task for the thread pool.
+void sweepTrades(
+         const Ohlc & ohlc,
+         const std::vector<int> & ibeg,
+         const std::vector<int> & iend,
+         const std::vector<int> & position,
+         const std::vector<double> & stopLoss,
+         const std::vector<double> & stopTrailing,
+         const std::vector<double> & profitTarget,
+         const std::vector<int> & maxDays,
+         double tickSize,
+         int threads,
+         const RangeIndex * index,
+         std::vector<int> & iendOut,
+         std::vector<double> & exitPriceOut,
+         std::vector<double> & gainOut,
+         std::vector<double> & minPriceOut,
+         std::vector<double> & maxPriceOut,
+         std::vector<double> & maeOut,
+         std::vector<double> & mfeOut,
+         std::vector<int> & exitReasonOut)
+{
+   std::size_t trades = ibeg.size();
+   std::size_t rows = trades*stopLoss.size();
+
+   // Pre-size the outputs - the workers write into disjoint slots
+   iendOut.resize(rows);
+   exitPriceOut.resize(rows);
+   gainOut.resize(rows);
+   minPriceOut.resize(rows);
+   maxPriceOut.resize(rows);
+   maeOut.resize(rows);
+   mfeOut.resize(rows);
+   exitReasonOut.resize(rows);
+
+   parallelFor(stopLoss.size(), threads, [&](std::size_t gg, int) {
+      for(std::size_t ii = 0, jj = gg*trades; ii < trades; ++ii, ++jj) {
+         processTrade(
+               ohlc,
+               ibeg[ii], iend[ii], position[ii], stopLoss[gg], stopTrailing[gg], profitTarget[gg], maxDays[gg], tickSize,
+               iendOut[jj], exitPriceOut[jj], exitReasonOut[jj], gainOut[jj], minPriceOut[jj], maxPriceOut[jj], maeOut[jj], mfeOut[jj],
+               index);
+      }
+   });
+}
+
+// The trades and the grid of a sweep, converted to c++ (0 based indexes) and validated
+struct SweepArgs {
+   std::vector<int> ibeg;
+   std::vector<int> iend;
+   std::vector<int> position;
+
+   // The grid - one parameter set per element
+   std::vector<double> stopLoss;
+   std::vector<double> stopTrailing;
+   std::vector<double> profitTarget;
+   std::vector<int> maxDays;
+
+   SweepArgs(
+         SEXP ibegsIn,
+         SEXP iendsIn,
+         SEXP positionIn,
+         SEXP stopLossIn,
+         SEXP stopTrailingIn,
+         SEXP profitTargetIn,
+         SEXP maxDaysIn) :
+      ibeg(Rcpp::as< std::vector<int> >( ibegsIn )),
+      iend(Rcpp::as< std::vector<int> >( iendsIn )),
+      position(Rcpp::as< std::vector<int> >( positionIn )),
+      stopLoss(Rcpp::as< std::vector<double> >( stopLossIn )),
+      stopTrailing(Rcpp::as< std::vector<double> >( stopTrailingIn )),
+      profitTarget(Rcpp::as< std::vector<double> >( profitTargetIn )),
+      maxDays(Rcpp::as< std::vector<int> >( maxDaysIn ))
+   {
+      if(ibeg.size() != iend.size() || ibeg.size() != position.size()) {
+         Rcpp::stop("the trade vectors must have the same length");
+      }
+
+      if(stopLoss.size() != stopTrailing.size() || stopLoss.size() != profitTarget.size() || stopLoss.size() != maxDays.size()) {
+         Rcpp::stop("the grid vectors must have the same length");
+      }
+   }
+
+   // vectors in c++ are zero based and in R are one based. convert, and check,
+   // on the main thread - the workers index the ohlc columns unchecked.
+   void toZeroBased(const Ohlc & ohlc) {
+      tradesToZeroBased(ibeg, iend, ohlc.size);
+   }
+
+   std::size_t gridSize() const { return stopLoss.size(); }
+
+   // The bars scanned by the whole sweep which benefit from the range index -
+   // only the parameter sets without a trailing stop do.
+   double indexedBars() const {
+      double bars = 0;
+      for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii) bars += iend[ii] - ibeg[ii];
+      return bars*std::count_if(stopTrailing.begin(), stopTrailing.end(), isNA);
+   }
+};
+
+// Streams the trades of each parameter set of the grid into a summary instead of
+// storing them, thus, the memory doesn't depend on the number of trades.
+void sweepSummaries(
+         const Ohlc & ohlc,
+         const std::vector<int> & ibeg,
+         const std::vector<int> & iend,
+         const std::vector<int> & position,
+         const std::vector<double> & stopLoss,
+         const std::vector<double> & stopTrailing,
+         const std::vector<double> & profitTarget,
+         const std::vector<int> & maxDays,
+         double tickSize,
+         int threads,
+         const RangeIndex * index,
+         std::vector<TradeSummary> & summaries)
+{
+   summaries.assign(stopLoss.size(), TradeSummary());
+
+   parallelFor(stopLoss.size(), threads, [&](std::size_t gg, int) {
+      TradeSummary & summary = summaries[gg];
+      for(std::size_t ii = 0; ii < ibeg.size(); ++ii) {
+         int exitIndex, exitReason;
+         double exitPrice, gain, minPrice, maxPrice, mae, mfe;
+         processTrade(
+               ohlc,
+               ibeg[ii], iend[ii], position[ii], stopLoss[gg], stopTrailing[gg], profitTarget[gg], maxDays[gg], tickSize,
+               exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe,
+               index);
+         summary.add(gain, mae, mfe, exitReason);
+      }
+   });
+}
+
+// The objectives to rank the parameter sets by, higher is better
+enum SweepObjective { SHARPE_OBJECTIVE, GAIN_OBJECTIVE, DRAWDOWN_OBJECTIVE };
+
+inline double objectiveValue(const TradeSummary & summary, int objective)
+{
+   double value;
+   switch(objective) {
+   case GAIN_OBJECTIVE: value = summary.totalGain(); break;
+   case DRAWDOWN_OBJECTIVE: value = summary.drawdownAdjusted(); break;
+   default: value = summary.sharpe(); break;
+   }
+
+   // NAs rank last
+   return std::isnan(value) ? R_NegInf : value;
+}
+
+struct RankedSummary {
+   double score;
+   std::size_t param;
+   TradeSummary summary;
+};
+
+// The better summary first: a higher score, ties go to the earlier parameter set
+inline bool betterSummary(const RankedSummary & aa, const RankedSummary & bb)
+{
+   if(aa.score != bb.score) return aa.score > bb.score;
+   return aa.param < bb.param;
+}
+
+// Like sweepSummaries, but keeps only the best top parameter sets by the objective,
+// the best first. Each worker keeps its own bounded heap and the heaps are merged at
+// the end, thus, the memory depends on top and the threads, not on the grid size.
+void sweepTop(
+         const Ohlc & ohlc,
+         const SweepArgs & args,
+         double tickSize,
+         int threads,
+         const RangeIndex * index,
+         std::size_t top,
+         int objective,
+         std::vector<std::size_t> & params,
+         std::vector<TradeSummary> & summaries)
+{
+   const std::vector<int> & ibeg = args.ibeg;
+   const std::vector<int> & iend = args.iend;
+   const std::vector<int> & position = args.position;
+   const std::vector<double> & stopLoss = args.stopLoss;
+   const std::vector<double> & stopTrailing = args.stopTrailing;
+   const std::vector<double> & profitTarget = args.profitTarget;
+   const std::vector<int> & maxDays = args.maxDays;
+
+   // The heaps keep the worst of their summaries at the front
+   std::vector< std::vector<RankedSummary> > heaps(threadCount(threads, args.gridSize()));
+
+   parallelFor(args.gridSize(), threads, [&](std::size_t gg, int worker) {
+      RankedSummary ranked;
+      ranked.param = gg;
+      for(std::size_t ii = 0; ii < ibeg.size(); ++ii) {
+         int exitIndex, exitReason;
+         double exitPrice, gain, minPrice, maxPrice, mae, mfe;
+         processTrade(
+               ohlc,
+               ibeg[ii], iend[ii], position[ii], stopLoss[gg], stopTrailing[gg], profitTarget[gg], maxDays[gg], tickSize,
+               exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe,
+               index);
+         ranked.summary.add(gain, mae, mfe, exitReason);
+      }
+      ranked.score = objectiveValue(ranked.summary, objective);
+
+      std::vector<RankedSummary> & heap = heaps[worker];
+      if(heap.size() < top) {
+         heap.push_back(ranked);
+         std::push_heap(heap.begin(), heap.end(), betterSummary);
+      } else if(betterSummary(ranked, heap.front())) {
+         std::pop_heap(heap.begin(), heap.end(), betterSummary);
+         heap.back() = ranked;
+         std::push_heap(heap.begin(), heap.end(), betterSummary);
+      }
+   });
+
+   // Merge the heaps
+   std::vector<RankedSummary> best;
+   for(std::size_t ww = 0; ww < heaps.size(); ++ww) {
+      best.insert(best.end(), heaps[ww].begin(), heaps[ww].end());
+   }
+   std::sort(best.begin(), best.end(), betterSummary);
+   if(best.size() > top) best.resize(top);
+
+   params.resize(best.size());
+   summaries.resize(best.size());
+   for(std::size_t jj = 0; jj < best.size(); ++jj) {
+      params[jj] = best[jj].param;
+      summaries[jj] = best[jj].summary;
+   }
+}
+
+// [[Rcpp::export("sweep.trades.interface")]]
+Rcpp::List sweepTradesInterface(
+                     SEXP ohlcIn,
+                     SEXP ibegsIn,
+                     SEXP iendsIn,
+                     SEXP positionIn,
+                     SEXP stopLossIn,
+                     SEXP stopTrailingIn,
+                     SEXP profitTargetIn,
+                     SEXP maxDaysIn,
+                     double tickSize,
+                     int threads)
+{
+   SweepArgs args(ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn);
+   const std::vector<int> & ibeg = args.ibeg;
+   const std::vector<int> & position = args.position;
+   const std::vector<double> & stopLoss = args.stopLoss;
+   const std::vector<double> & stopTrailing = args.stopTrailing;
+   const std::vector<double> & profitTarget = args.profitTarget;
+
+   // Borrow the ohlc columns (matrix or bar session), shared read-only by all workers
+   OhlcArg ohlcArg(ohlcIn);
+   const Ohlc & ohlc = ohlcArg.ohlc();
+   args.toZeroBased(ohlc);
+
+   // The range index is shared read-only by all workers
+   const RangeIndex * index = ohlcArg.rangeIndex(args.indexedBars());
+
+   std::vector<int> iendOut;
+   std::vector<double> exitPrice;
+   std::vector<double> minPrice;
+   std::vector<double> maxPrice;
+   std::vector<double> gain;
+   std::vector<double> mae;
+   std::vector<double> mfe;
+   std::vector<int> reason;
+
+   sweepTrades(
+         ohlc,
+         ibeg, args.iend, position, stopLoss, stopTrailing, profitTarget, args.maxDays, tickSize, threads, index,
+         iendOut, exitPrice, gain, minPrice, maxPrice, mae, mfe, reason);
+   // Expand the inputs to match the output rows. Indexes are converted back to 1 based.
+   std::size_t trades = ibeg.size();
+   std::size_t total = iendOut.size();
+   Rcpp::IntegerVector paramOut(total);
+   Rcpp::IntegerVector ibegOut(total);
+   Rcpp::IntegerVector positionOut(total);
+   Rcpp::NumericVector stopLossOut(total);
+   Rcpp::NumericVector stopTrailingOut(total);
+   Rcpp::NumericVector profitTargetOut(total);
+   for(std::size_t jj = 0; jj < total; ++jj) {
+      std::size_t gg = jj / trades;
+      std::size_t ii = jj % trades;
+      paramOut[jj] = gg + 1;
+      ibegOut[jj] = ibeg[ii] + 1;
+      positionOut[jj] = position[ii];
+      stopLossOut[jj] = stopLoss[gg];
+      stopTrailingOut[jj] = stopTrailing[gg];
+      profitTargetOut[jj] = profitTarget[gg];
+      iendOut[jj] += 1;
+   }
+
+   return Rcpp::DataFrame::create(
+               Rcpp::Named("Param") = paramOut,
+               Rcpp::Named("Entry") = ibegOut,
+               Rcpp::Named("Exit") = iendOut,
+               Rcpp::Named("Position") = positionOut,
+               Rcpp::Named("StopLoss") = stopLossOut,
+               Rcpp::Named("StopTrailing") = stopTrailingOut,
+               Rcpp::Named("ProfitTarget") = profitTargetOut,
+               Rcpp::Named("ExitPrice") = exitPrice,
+               Rcpp::Named("Gain") = gain,
+               Rcpp::Named("MinPrice") = minPrice,
+               Rcpp::Named("MaxPrice") = maxPrice,
+               Rcpp::Named("MAE") = mae,
+               Rcpp::Named("MFE") = mfe,
+               Rcpp::Named("Reason") = reason);
+}
+
+
+// One row per parameter set: the parameters, followed by the summary of the trades
+// and the number of trades per exit reason. summaries[jj] belongs to the grid row
+// params[jj] (0 based).
+Rcpp::List summaryList(
+               const SweepArgs & args,
+               const std::vector<std::size_t> & params,
+               const std::vector<TradeSummary> & summaries)
+{
+   std::size_t rows = params.size();
+   Rcpp::IntegerVector paramOut(rows);
+   Rcpp::NumericVector stopLossOut(rows);
+   Rcpp::NumericVector stopTrailingOut(rows);
+   Rcpp::NumericVector profitTargetOut(rows);
+   Rcpp::IntegerVector maxDaysOut(rows);
+   Rcpp::IntegerVector tradesOut(rows);
+   Rcpp::NumericVector gainOut(rows);
+   Rcpp::NumericVector equityOut(rows);
+   Rcpp::NumericVector sharpeOut(rows);
+   Rcpp::NumericVector drawdownOut(rows);
+   Rcpp::NumericVector winRateOut(rows);
+   Rcpp::NumericVector profitFactorOut(rows);
+   Rcpp::NumericVector maeOut(rows);
+   Rcpp::NumericVector mfeOut(rows);
+   std::vector<Rcpp::IntegerVector> reasonsOut;
+   for(int rr = 0; rr < EXIT_REASONS; ++rr) reasonsOut.push_back(Rcpp::IntegerVector(rows));
+
+   for(std::size_t jj = 0; jj < rows; ++jj) {
+      std::size_t gg = params[jj];
+      const TradeSummary & summary = summaries[jj];
+      paramOut[jj] = gg + 1;
+      stopLossOut[jj] = args.stopLoss[gg];
+      stopTrailingOut[jj] = args.stopTrailing[gg];
+      profitTargetOut[jj] = args.profitTarget[gg];
+      maxDaysOut[jj] = args.maxDays[gg];
+      tradesOut[jj] = summary.trades.trades;
+      gainOut[jj] = summary.totalGain();
+      equityOut[jj] = summary.equity.equity;
+      sharpeOut[jj] = summary.sharpe();
+      drawdownOut[jj] = summary.equity.maxDrawdown;
+      winRateOut[jj] = summary.trades.winRate();
+      profitFactorOut[jj] = summary.trades.profitFactor();
+      maeOut[jj] = summary.trades.averageMae();
+      mfeOut[jj] = summary.trades.averageMfe();
+      for(int rr = 0; rr < EXIT_REASONS; ++rr) reasonsOut[rr][jj] = summary.trades.reasons[rr];
+   }
+
+   // More columns than DataFrame::create takes - build the list by hand
+   Rcpp::List res(14 + EXIT_REASONS);
+   Rcpp::CharacterVector names(res.size());
+   int cc = 0;
+   names[cc] = "Param"; res[cc++] = paramOut;
+   names[cc] = "StopLoss"; res[cc++] = stopLossOut;
+   names[cc] = "StopTrailing"; res[cc++] = stopTrailingOut;
+   names[cc] = "ProfitTarget"; res[cc++] = profitTargetOut;
+   names[cc] = "MaxDays"; res[cc++] = maxDaysOut;
+   names[cc] = "Trades"; res[cc++] = tradesOut;
+   names[cc] = "Gain"; res[cc++] = gainOut;
+   names[cc] = "Equity"; res[cc++] = equityOut;
+   names[cc] = "Sharpe"; res[cc++] = sharpeOut;
+   names[cc] = "MaxDrawdown"; res[cc++] = drawdownOut;
+   names[cc] = "WinRate"; res[cc++] = winRateOut;
+   names[cc] = "ProfitFactor"; res[cc++] = profitFactorOut;
+   names[cc] = "AvgMAE"; res[cc++] = maeOut;
+   names[cc] = "AvgMFE"; res[cc++] = mfeOut;
+   for(int rr = 0; rr < EXIT_REASONS; ++rr) {
+      names[cc] = EXIT_REASON_NAMES[rr];
+      res[cc++] = reasonsOut[rr];
+   }
+   res.attr("names") = names;
+
+   return res;
+}
+
+// [[Rcpp::export("sweep.summary.interface")]]
+Rcpp::List sweepSummaryInterface(
+                     SEXP ohlcIn,
+                     SEXP ibegsIn,
+                     SEXP iendsIn,
+                     SEXP positionIn,
+                     SEXP stopLossIn,
+                     SEXP stopTrailingIn,
+                     SEXP profitTargetIn,
+                     SEXP maxDaysIn,
+                     double tickSize,
+                     int threads,
+                     int top,
+                     std::string objective)
+{
+   SweepArgs args(ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn);
+
+   int objectiveId;
+   if(objective == "sharpe") {
+      objectiveId = SHARPE_OBJECTIVE;
+   } else if(objective == "gain") {
+      objectiveId = GAIN_OBJECTIVE;
+   } else if(objective == "drawdown") {
+      objectiveId = DRAWDOWN_OBJECTIVE;
+   } else {
+      Rcpp::stop("unknown objective: " + objective);
+   }
+
+   OhlcArg ohlcArg(ohlcIn);
+   const Ohlc & ohlc = ohlcArg.ohlc();
+   args.toZeroBased(ohlc);
+   const RangeIndex * index = ohlcArg.rangeIndex(args.indexedBars());
+
+   std::vector<std::size_t> params;
+   std::vector<TradeSummary> summaries;
+   if(top > 0) {
+      // Only the best parameter sets, the best first
+      sweepTop(ohlc, args, tickSize, threads, index, top, objectiveId, params, summaries);
+      return summaryList(args, params, summaries);
+   }
+
+   sweepSummaries(
+         ohlc,
+         args.ibeg, args.iend, args.position, args.stopLoss, args.stopTrailing, args.profitTarget, args.maxDays,
+         tickSize, threads, index, summaries);
+
+   params.resize(args.gridSize());
+   for(std::size_t gg = 0; gg < params.size(); ++gg) params[gg] = gg;
+
+   return summaryList(args, params, summaries);
+}
\ No newline at end of file
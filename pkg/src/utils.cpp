@@ -27,17 +27,26 @@
 
 #include <Rcpp.h>
 #include "common.h"
+#include "session.h"
+#include "laguerre.h"
+#include "parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace Rcpp;
 
-void locf(std::vector<double> & v, double value) {
+void locf(double * v, int size, double value) {
    if(!isNA(value)) {
-      for(std::vector<double>::size_type ii = 1; ii < v.size(); ++ii) {
+      for(int ii = 1; ii < size; ++ii) {
          if(!isNA(v[ii-1]) && v[ii] == value) v[ii] = v[ii-1];
       }
    } else {
       // na.locf behaviour
-      for(std::vector<double>::size_type ii = 1; ii < v.size(); ++ii) {
+      for(int ii = 1; ii < size; ++ii) {
          if(isNA(v[ii]) && !isNA(v[ii-1])) v[ii] = v[ii-1];
       }
    }
@@ -46,10 +55,26 @@ void locf(std::vector<double> & v, double value) {
 // [[Rcpp::export("locf.interface")]]
 Rcpp::NumericVector locfInterface(SEXP vin, double value)
 {
-   std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
-   locf(v, value);
+   Rcpp::NumericVector v = Rcpp::clone(Rcpp::NumericVector(vin));
+   locf(v.begin(), v.size(), value);
+
+   return v;
+}
+
+// Fills each column of a matrix, the columns are spread over the threads
+// [[Rcpp::export("locf.matrix.interface")]]
+Rcpp::NumericMatrix locfMatrixInterface(SEXP vin, double value, int threads)
+{
+   // A single copy, filled in place
+   Rcpp::NumericMatrix v = Rcpp::clone(Rcpp::NumericMatrix(vin));
+   double * data = v.begin();
+   int rows = v.nrow();
+
+   parallelFor(v.ncol(), threads, [=](std::size_t cc, int) {
+      locf(data + cc*rows, rows, value);
+   });
 
-   return Rcpp::NumericVector(v.begin(), v.end());
+   return v;
 }
 
 // [[Rcpp::export("leading.nas.interface")]]
@@ -62,84 +87,275 @@ double leadingNAs(SEXP vin)
    return ii;
 }
 
-void laguerreFilter(const std::vector<double> & prices, double gamma, std::vector<double> & out)
+void laguerreFilter(const double * prices, int size, double gamma, double * out)
 {
-   out.resize(prices.size());
-
-   std::vector<double> l0(prices.size(), 0.0);
-   std::vector<double> l1(prices.size(), 0.0);
-   std::vector<double> l2(prices.size(), 0.0);
-   std::vector<double> l3(prices.size(), 0.0);
-   
-   for(int jj = 1; jj < 4; ++jj) l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-   for(int jj = 2; jj < 4; ++jj) l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-   l2[3] = -gamma*l1[3] + l1[2] + gamma*l2[2];
-   
-   for(std::vector<double>::size_type jj = 4; jj < prices.size(); ++jj) {
-      l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-      l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-      l2[jj] = -gamma*l1[jj] + l1[jj-1] + gamma*l2[jj-1];
-      l3[jj] = -gamma*l2[jj] + l2[jj-1] + gamma*l3[jj-1];
+   LaguerreState state(gamma);
+   for(int jj = 0; jj < size; ++jj) {
+      state.update(prices[jj]);
+      out[jj] = state.filter();
    }
-   
-   for(std::vector<double>::size_type jj = 0; jj < prices.size(); ++jj) out[jj] = (l0[jj] + 2.0*l1[jj] + 2.0*l2[jj] + l3[jj]) / 6.0;
 }
 
 // [[Rcpp::export("laguerre.filter.interface")]]
 Rcpp::NumericVector laguerreFilterInterface(SEXP vin, double gamma)
 {
-   std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
-   std::vector<double> vout;
+   // Either a vector or a bar session (the close is used)
+   PricesArg v(vin);
+   Rcpp::NumericVector vout(v.size());
    
-   laguerreFilter(v, gamma, vout);
+   laguerreFilter(v.prices(), v.size(), gamma, vout.begin());
 
-   return Rcpp::NumericVector(vout.begin(), vout.end());
+   return vout;
 }
 
-void laguerreRSI(const std::vector<double> & prices, double gamma, std::vector<double> & rsi)
+void laguerreRSI(const double * prices, int size, double gamma, double * rsi)
 {
-   rsi.resize(prices.size());
+   LaguerreState state(gamma);
+   for(int jj = 0; jj < size; ++jj) {
+      state.update(prices[jj]);
+      rsi[jj] = state.rsi();
+   }
+}
 
-   std::vector<double> l0(prices.size(), 0.0);
-   std::vector<double> l1(prices.size(), 0.0);
-   std::vector<double> l2(prices.size(), 0.0);
-   std::vector<double> l3(prices.size(), 0.0);
-   
-   for(int jj = 1; jj < 4; ++jj) l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-   for(int jj = 2; jj < 4; ++jj) l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-   l2[3] = -gamma*l1[3] + l1[2] + gamma*l2[2];
+// [[Rcpp::export("laguerre.rsi.interface")]]
+Rcpp::NumericVector laguerreRSIInterface(SEXP vin, double gamma)
+{
+   // Either a vector or a bar session (the close is used)
+   PricesArg v(vin);
+   Rcpp::NumericVector rsi(v.size());
    
-   for(std::vector<double>::size_type jj = 4; jj < prices.size(); ++jj) {
-      l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-      l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-      l2[jj] = -gamma*l1[jj] + l1[jj-1] + gamma*l2[jj-1];
-      l3[jj] = -gamma*l2[jj] + l2[jj-1] + gamma*l3[jj-1];
+   laguerreRSI(v.prices(), v.size(), gamma, rsi.begin());
+
+   return rsi;
+}
+
+// The gammas run in groups of LAGUERRE_LANES, one gamma per vector lane
+#define LAGUERRE_LANES 4
+
+#if defined(__AVX2__)
+
+// One bar for a group of gammas, past the warm-up. The operations are in the
+// order of the scalar code, but the compiler may contract either to FMA, thus,
+// the results match it up to rounding only.
+inline void laguerreLanes(
+         double price,
+         const double * gamma,
+         double * l0,
+         double * l1,
+         double * l2,
+         double * l3,
+         bool rsi,
+         double * values)
+{
+   __m256d gg = _mm256_loadu_pd(gamma);
+   __m256d ng = _mm256_sub_pd(_mm256_setzero_pd(), gg);
+   __m256d o0 = _mm256_loadu_pd(l0);
+   __m256d o1 = _mm256_loadu_pd(l1);
+   __m256d o2 = _mm256_loadu_pd(l2);
+   __m256d o3 = _mm256_loadu_pd(l3);
+
+   __m256d n0 = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), gg), _mm256_set1_pd(price)), _mm256_mul_pd(gg, o0));
+   __m256d n1 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ng, n0), o0), _mm256_mul_pd(gg, o1));
+   __m256d n2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ng, n1), o1), _mm256_mul_pd(gg, o2));
+   __m256d n3 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ng, n2), o2), _mm256_mul_pd(gg, o3));
+
+   _mm256_storeu_pd(l0, n0);
+   _mm256_storeu_pd(l1, n1);
+   _mm256_storeu_pd(l2, n2);
+   _mm256_storeu_pd(l3, n3);
+
+   if(!rsi) {
+      __m256d two = _mm256_set1_pd(2.0);
+      __m256d sum = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(n0, _mm256_mul_pd(two, n1)), _mm256_mul_pd(two, n2)), n3);
+      _mm256_storeu_pd(values, _mm256_div_pd(sum, _mm256_set1_pd(6.0)));
+      return;
    }
-   
-   for(std::vector<double>::size_type jj = 0; jj < prices.size(); ++jj) {
-      double cu = 0.0;
-      double cd = 0.0;
 
-      if(l0[jj] > l1[jj]) cu = l0[jj] - l1[jj];
-      else cd = l1[jj] - l0[jj];
+   // The branches of the scalar code become masks
+   __m256d up = _mm256_cmp_pd(n0, n1, _CMP_GT_OQ);
+   __m256d cu = _mm256_and_pd(up, _mm256_sub_pd(n0, n1));
+   __m256d cd = _mm256_andnot_pd(up, _mm256_sub_pd(n1, n0));
+
+   up = _mm256_cmp_pd(n1, n2, _CMP_GT_OQ);
+   cu = _mm256_add_pd(cu, _mm256_and_pd(up, _mm256_sub_pd(n1, n2)));
+   cd = _mm256_add_pd(cd, _mm256_andnot_pd(up, _mm256_sub_pd(n2, n1)));
+
+   up = _mm256_cmp_pd(n2, n3, _CMP_GT_OQ);
+   cu = _mm256_add_pd(cu, _mm256_and_pd(up, _mm256_sub_pd(n2, n3)));
+   cd = _mm256_add_pd(cd, _mm256_andnot_pd(up, _mm256_sub_pd(n3, n2)));
+
+   __m256d total = _mm256_add_pd(cu, cd);
+   __m256d positive = _mm256_cmp_pd(total, _mm256_setzero_pd(), _CMP_GT_OQ);
+   _mm256_storeu_pd(values, _mm256_and_pd(positive, _mm256_div_pd(cu, total)));
+}
+
+#elif defined(__SSE2__)
+
+// The same with SSE2, available on all x86-64, two lanes at a time
+inline void laguerrePair(
+         double price,
+         const double * gamma,
+         double * l0,
+         double * l1,
+         double * l2,
+         double * l3,
+         bool rsi,
+         double * values)
+{
+   __m128d gg = _mm_loadu_pd(gamma);
+   __m128d ng = _mm_sub_pd(_mm_setzero_pd(), gg);
+   __m128d o0 = _mm_loadu_pd(l0);
+   __m128d o1 = _mm_loadu_pd(l1);
+   __m128d o2 = _mm_loadu_pd(l2);
+   __m128d o3 = _mm_loadu_pd(l3);
+
+   __m128d n0 = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_set1_pd(1.0), gg), _mm_set1_pd(price)), _mm_mul_pd(gg, o0));
+   __m128d n1 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ng, n0), o0), _mm_mul_pd(gg, o1));
+   __m128d n2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ng, n1), o1), _mm_mul_pd(gg, o2));
+   __m128d n3 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ng, n2), o2), _mm_mul_pd(gg, o3));
+
+   _mm_storeu_pd(l0, n0);
+   _mm_storeu_pd(l1, n1);
+   _mm_storeu_pd(l2, n2);
+   _mm_storeu_pd(l3, n3);
+
+   if(!rsi) {
+      __m128d two = _mm_set1_pd(2.0);
+      __m128d sum = _mm_add_pd(_mm_add_pd(_mm_add_pd(n0, _mm_mul_pd(two, n1)), _mm_mul_pd(two, n2)), n3);
+      _mm_storeu_pd(values, _mm_div_pd(sum, _mm_set1_pd(6.0)));
+      return;
+   }
+
+   __m128d up = _mm_cmpgt_pd(n0, n1);
+   __m128d cu = _mm_and_pd(up, _mm_sub_pd(n0, n1));
+   __m128d cd = _mm_andnot_pd(up, _mm_sub_pd(n1, n0));
+
+   up = _mm_cmpgt_pd(n1, n2);
+   cu = _mm_add_pd(cu, _mm_and_pd(up, _mm_sub_pd(n1, n2)));
+   cd = _mm_add_pd(cd, _mm_andnot_pd(up, _mm_sub_pd(n2, n1)));
+
+   up = _mm_cmpgt_pd(n2, n3);
+   cu = _mm_add_pd(cu, _mm_and_pd(up, _mm_sub_pd(n2, n3)));
+   cd = _mm_add_pd(cd, _mm_andnot_pd(up, _mm_sub_pd(n3, n2)));
+
+   __m128d total = _mm_add_pd(cu, cd);
+   __m128d positive = _mm_cmpgt_pd(total, _mm_setzero_pd());
+   _mm_storeu_pd(values, _mm_and_pd(positive, _mm_div_pd(cu, total)));
+}
 
-      if(l1[jj] > l2[jj]) cu += l1[jj] - l2[jj];
-      else cd += l2[jj] - l1[jj];
+inline void laguerreLanes(
+         double price,
+         const double * gamma,
+         double * l0,
+         double * l1,
+         double * l2,
+         double * l3,
+         bool rsi,
+         double * values)
+{
+   laguerrePair(price, gamma, l0, l1, l2, l3, rsi, values);
+   laguerrePair(price, gamma + 2, l0 + 2, l1 + 2, l2 + 2, l3 + 2, rsi, values + 2);
+}
 
-      if(l2[jj] > l3[jj]) cu += l2[jj] - l3[jj];
-      else cd += l3[jj] - l2[jj];
-      
-      if((cu + cd) > 0.0) rsi[jj] = cu / (cu + cd);
+#else
+
+// The scalar fallback
+inline void laguerreLanes(
+         double price,
+         const double * gamma,
+         double * l0,
+         double * l1,
+         double * l2,
+         double * l3,
+         bool rsi,
+         double * values)
+{
+   for(int ll = 0; ll < LAGUERRE_LANES; ++ll) {
+      LaguerreState::step(price, gamma[ll], 4, l0[ll], l1[ll], l2[ll], l3[ll]);
+      if(rsi) values[ll] = LaguerreState::rsiValue(l0[ll], l1[ll], l2[ll], l3[ll]);
+      else values[ll] = LaguerreState::filterValue(l0[ll], l1[ll], l2[ll], l3[ll]);
    }
 }
 
-// [[Rcpp::export("laguerre.rsi.interface")]]
-Rcpp::NumericVector laguerreRSIInterface(SEXP vin, double gamma)
+#endif
+
+// The Laguerre filter, or the rsi, for several gammas in a single pass over the
+// prices. out is a column major size x gammas.size() matrix, a column per gamma.
+void laguerreBatch(const double * prices, int size, const std::vector<double> & gammas, bool rsi, double * out)
 {
-   std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
-   std::vector<double> rsi;
-   
-   laguerreRSI(v, gamma, rsi);
+   int count = gammas.size();
+   if(count == 0) return;
+
+   // Pad the last group with copies of the last gamma
+   int groups = (count + LAGUERRE_LANES - 1) / LAGUERRE_LANES;
+   int lanes = groups*LAGUERRE_LANES;
+   std::vector<double> gamma(lanes);
+   for(int ll = 0; ll < lanes; ++ll) gamma[ll] = gammas[std::min(ll, count - 1)];
+
+   std::vector<double> l0(lanes, 0.0);
+   std::vector<double> l1(lanes, 0.0);
+   std::vector<double> l2(lanes, 0.0);
+   std::vector<double> l3(lanes, 0.0);
+   std::vector<double> values(lanes);
+
+   // The warm-up - the stages start one after the other
+   int warmup = std::min(size, 4);
+   for(int jj = 0; jj < warmup; ++jj) {
+      for(int ll = 0; ll < count; ++ll) {
+         LaguerreState::step(prices[jj], gamma[ll], jj, l0[ll], l1[ll], l2[ll], l3[ll]);
+         if(rsi) out[(std::size_t)ll*size + jj] = LaguerreState::rsiValue(l0[ll], l1[ll], l2[ll], l3[ll]);
+         else out[(std::size_t)ll*size + jj] = LaguerreState::filterValue(l0[ll], l1[ll], l2[ll], l3[ll]);
+      }
+   }
+
+   for(int jj = warmup; jj < size; ++jj) {
+      for(int ll = 0; ll < lanes; ll += LAGUERRE_LANES) {
+         laguerreLanes(prices[jj], &gamma[ll], &l0[ll], &l1[ll], &l2[ll], &l3[ll], rsi, &values[ll]);
+      }
+
+      for(int ll = 0; ll < count; ++ll) out[(std::size_t)ll*size + jj] = values[ll];
+   }
+}
+
+// [[Rcpp::export("laguerre.batch.interface")]]
+Rcpp::NumericMatrix laguerreBatchInterface(SEXP vin, SEXP gammasIn, bool rsi)
+{
+   // Either a vector or a bar session (the close is used)
+   PricesArg v(vin);
+   std::vector<double> gammas = Rcpp::as< std::vector<double> >(gammasIn);
+
+   Rcpp::NumericMatrix res(v.size(), (int)gammas.size());
+   laguerreBatch(v.prices(), v.size(), gammas, rsi, res.begin());
+
+   return res;
+}
+
+// A Laguerre filter for live feeds - the state survives between the calls
+// [[Rcpp::export("laguerre.state.interface")]]
+SEXP laguerreStateInterface(double gamma)
+{
+   return wrapPointer(new LaguerreState(gamma), "laguerre state");
+}
+
+// Feeds the new prices through the state, returns the filter and the rsi for each.
+// Like laguerre.filter and laguerre.rsi, the first four bars are NA.
+// [[Rcpp::export("laguerre.update.interface")]]
+Rcpp::NumericMatrix laguerreUpdateInterface(SEXP stateIn, SEXP pricesIn)
+{
+   LaguerreState * state = unwrapPointer<LaguerreState>(stateIn, "laguerre state");
+   Rcpp::NumericVector prices(pricesIn);
+
+   int size = prices.size();
+   Rcpp::NumericMatrix res(size, 2);
+   for(int jj = 0; jj < size; ++jj) {
+      state->update(prices[jj]);
+      if(state->bars() > 4) {
+         res(jj, 0) = state->filter();
+         res(jj, 1) = state->rsi();
+      } else {
+         res(jj, 0) = res(jj, 1) = NA_REAL;
+      }
+   }
 
-   return Rcpp::NumericVector(rsi.begin(), rsi.end());
+   return res;
 }
\ No newline at end of file
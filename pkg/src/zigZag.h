@@ -0,0 +1,160 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef ZIG_ZAG_H_INCLUDED
+#define ZIG_ZAG_H_INCLUDED
+
+#include "common.h"
+
+// A zig-zag, one bar at a time. The outputs for a bar depend only on the state
+// and the inputs of the bar, thus, zig-zags with different thresholds can advance
+// side by side over the same prices, and a zig-zag can be continued as new bars
+// arrive.
+//
+// A swing reverses once the price retraces more than the threshold (change) from
+// the last extreme. The threshold in effect is the one from the bar of the extreme.
+class ZigZag {
+public:
+   explicit ZigZag(bool percent) :
+      percent_(percent), phase_(SKIP_NAS), state_(0), extreme_(0.0), threshold_(0.0),
+      inflection_(NA_REAL), target_(NA_REAL), age_(0)
+   {}
+
+   // Processes the next bar. indicator is 1 for an up swing, -1 for a down swing
+   // and 0 until the first swing. inflection is the price at the start of the
+   // swing, target the threshold in effect, correction the retracement from the
+   // extreme and age the number of bars since the start of the swing.
+   void step(
+         double close,
+         double change,
+         int & indicator,
+         double & inflection,
+         double & target,
+         double & correction,
+         int & age) {
+
+      indicator = 0;
+      inflection = NA_REAL;
+      target = NA_REAL;
+      correction = 0.0;
+      age = 0;
+
+      switch(phase_) {
+      case SKIP_NAS:
+         // Skip all NAs in the changes
+         if(isNA(change)) return;
+
+         phase_ = FIRST_SWING;
+         extreme_ = close;
+         threshold_ = change;
+         return;
+
+      case FIRST_SWING:
+         // Find the first up or down state
+         if(percent_) {
+            if(close/extreme_ - 1.0 > threshold_) state_ = 1;
+            else if(1.0 - close/extreme_ > threshold_) state_ = -1;
+         } else {
+            if(close - extreme_ > threshold_) state_ = 1;
+            else if(extreme_ - close > threshold_) state_ = -1;
+         }
+
+         if(state_ != 0) {
+            phase_ = SWINGS;
+            extreme_ = close;
+            threshold_ = change;
+            indicator = state_;
+            inflection = close;
+            target = change;
+            remember(inflection, target, age);
+         }
+         return;
+
+      default:
+         break;
+      }
+
+      if(state_ == 1 ? close >= extreme_ : close <= extreme_) {
+         // A new extreme
+         indicator = state_;
+         age = age_ + 1;
+         inflection = inflection_;
+         threshold_ = change;
+         target = change;
+         extreme_ = close;
+      } else {
+         double retracement;
+         if(percent_) {
+            retracement = state_ == 1 ? 1.0 - close/extreme_ : close/extreme_ - 1.0;
+         } else {
+            retracement = state_ == 1 ? extreme_ - close : close - extreme_;
+         }
+
+         if(retracement > threshold_) {
+            // Change in state
+            state_ = -state_;
+            indicator = state_;
+            age = 0;
+            inflection = close;
+            extreme_ = close;
+            threshold_ = change;
+            target = change;
+         } else {
+            indicator = state_;
+            age = age_ + 1;
+            inflection = inflection_;
+            correction = retracement;
+            target = target_;
+         }
+      }
+
+      remember(inflection, target, age);
+   }
+
+private:
+   enum Phase { SKIP_NAS, FIRST_SWING, SWINGS };
+
+   void remember(double inflection, double target, int age) {
+      inflection_ = inflection;
+      target_ = target;
+      age_ = age;
+   }
+
+   bool percent_;
+   int phase_;
+
+   // The swing (1 or -1), the price at its last extreme and the threshold in effect
+   int state_;
+   double extreme_;
+   double threshold_;
+
+   // The outputs of the previous bar
+   double inflection_;
+   double target_;
+   int age_;
+};
+
+#endif // ZIG_ZAG_H_INCLUDED